@@ -2,18 +2,17 @@
 #include "../Util/Helper.h"
 #include "../Util/StringOperations.h"
 
-#include <conio.h>
+#include <algorithm>
+#include <cstring>
 #include <queue>
 
-static HANDLE hNetworkEvent;
-static HANDLE hInputEvent;
-static HANDLE allEvents[2];
 static std::string text;
 
 bool Client::InitClient(const NetworkConfig& initConfig)
 {
     // Set config
     m_Config = initConfig;
+    KG_ASSERT(m_Config.m_MaxPacketSize >= k_MinPacketSize && m_Config.m_MaxPacketSize <= k_MaxPacketSize);
 
     // Initialize the OS specific socket context
     if (!SocketContext::InitializeSockets())
@@ -30,41 +29,42 @@ bool Client::InitClient(const NetworkConfig& initConfig)
         return false;
     }
 
+    // Path probes must be dropped rather than fragmented when they exceed the path
+    m_ClientSocket.EnablePathMtuProbing();
+
     // Initialize server connection
     m_ServerConnection.Init(initConfig);
 
-    m_NetworkEventQueue.Init(KG_BIND_CLASS_FN(OnEvent));
+    m_NetworkEventQueue.Init(m_Config.m_EventQueueCapacity);
+
+    // Create the pool that received packets are handed to the application in
+    m_PacketPool.Init(m_Config.m_PacketPoolCapacity);
+    m_ReassemblyPool.Init(m_Config.m_ReassemblyPoolCapacity, k_ReassemblyBlockSize);
+    m_PacketCompressor.Init(m_Config.m_CompressionDictionary);
 
-    // TODO: Move this please for the love of god
-    // Create network event
-    hNetworkEvent = WSACreateEvent();
-    if (WSAEventSelect(m_ClientSocket.GetHandle(), hNetworkEvent, FD_READ) != 0)
+    // Create the reactor that the network thread blocks on (socket, events, timer, and console)
+    if (!m_Reactor.Init(m_ClientSocket.GetHandle(), true))
     {
-        TSLogger::Log("Failed to create the network event handle");
+        TSLogger::Log("Failed to initialize the network reactor\n");
+        SocketContext::ShutdownSockets();
         return false;
     }
 
-    // Get console input handle
-    hInputEvent = GetStdHandle(STD_INPUT_HANDLE);
-    SetConsoleMode(hInputEvent, 0);
-
-    // Wait for both events
-    allEvents[0] = hNetworkEvent;
-    allEvents[1] = hInputEvent;
-
     // Initialize local timers
     m_NetworkThreadTimer.InitializeTimer();
     m_RequestConnectionTimer.InitializeTimer(m_Config.m_RequestConnectionFrequency);
+    m_Reactor.StartTimer(m_NetworkThreadTimer.GetConstantFrameTime());
 
     // Send initial connection request
     m_ServerConnection.m_Status = ConnectionStatus::Connecting;
-    SendToServer(PacketType::ConnectionRequest, nullptr, 0);
+    SendConnectionRequest();
 
     // Start request connection
     m_NetworkThread.StartThread(KG_BIND_CLASS_FN(RequestConnection));
 
     // Wait for request connection to complete
     m_NetworkThread.WaitOnThread();
+    m_Reactor.StopTimer();
     
     // Ensure the connection was successful
     if (m_ServerConnection.m_Status != ConnectionStatus::Connected)
@@ -77,15 +77,23 @@ bool Client::InitClient(const NetworkConfig& initConfig)
     m_NetworkThreadTimer.InitializeTimer();
     m_KeepAliveTimer.InitializeTimer(m_Config.m_SyncPingFrequency);
     m_NetworkThread.StartThread(KG_BIND_CLASS_FN(RunNetworkThread));
-    m_NetworkEventThread.StartThread(KG_BIND_CLASS_FN(RunNetworkEventThread));
 
     return true;
 }
 
 bool Client::TerminateClient()
 {
-    // Join the network thread
-    m_NetworkThread.StopThread();
+    // Signal, wake, and join the network thread
+    m_NetworkThread.StopThread(true);
+    m_Reactor.Wake();
+    m_NetworkThread.WaitOnThread();
+    m_Reactor.Terminate();
+
+    // Return the receive buffers to the pool
+    for (PacketHandle& packet : m_ReceivePackets)
+    {
+        packet.Reset();
+    }
 
     // Clean up socket resources
     SocketContext::ShutdownSockets();
@@ -96,110 +104,251 @@ bool Client::TerminateClient()
 void Client::WaitOnClientTerminate()
 {
     m_NetworkThread.WaitOnThread();
-    m_NetworkEventThread.WaitOnThread();
 }
 
 void Client::RunNetworkThread()
 {
+    // Block until a packet, submitted event, or key press is available
+    BitField<uint8_t> readyEvents = m_Reactor.Wait();
+
+    if (readyEvents.IsFlagSet(ReactorEvent::ConsoleInput))
+    {
+        SubmitConsoleInput();
+    }
+
     // Process the network event queue
-    m_NetworkEventQueue.ProcessQueue();
+    m_NetworkEventQueue.ProcessQueue(KG_BIND_CLASS_FN(OnEvent));
 
-    Address sender;
-    unsigned char buffer[k_MaxPacketSize];
-    int bytes_read{ 0 };
+    if (!m_NetworkThread.IsRunning() || !readyEvents.IsFlagSet(ReactorEvent::SocketReadable))
+    {
+        return;
+    }
+
+    int numPackets{ 0 };
+    int numSlots{ 0 };
 
     do
     {
-        bytes_read = m_ClientSocket.Receive(sender, buffer, sizeof(buffer));
-        if (bytes_read >= k_PacketHeaderSize)
+        // Make sure the receive slots hold pooled buffers
+        for (numSlots = 0; numSlots < k_MaxPacketBatchSize; numSlots++)
         {
-            // Check for a valid app ID
-            if (*(AppID*)&buffer != m_Config.m_AppProtocolID)
+            PacketHandle& packet = m_ReceivePackets[numSlots];
+            if (!packet)
             {
-                TSLogger::Log("Failed to validate the app ID from packet\n");
-                continue;
+                packet = m_PacketPool.Acquire();
+            }
+            if (!packet)
+            {
+                break;
             }
+        }
 
-            PacketType type = (PacketType)buffer[sizeof(AppID)];
+        // Fall back to the fixed batch if the pool is exhausted (packets with reliable messages are dropped unacknowledged)
+        if (numSlots == 0)
+        {
+            numSlots = k_MaxPacketBatchSize;
+            numPackets = m_ClientSocket.ReceiveBatch(m_ReceiveBatch);
 
-            if (IsConnectionManagementPacket(type))
+            for (int iteration{ 0 }; iteration < numPackets; iteration++)
             {
-                continue;
+                HandlePacket(m_ReceiveBatch.m_Addresses[iteration], m_ReceiveBatch.m_Buffers[iteration],
+                    m_ReceiveBatch.m_Sizes[iteration]);
             }
+            continue;
+        }
 
-            // TODO: Verify this message is for the correct client
-            ClientIndex index = (ClientIndex)buffer[sizeof(AppID) + sizeof(PacketType)];
-
-            // Process reliability segment
-            m_ServerConnection.m_Connection.m_ReliabilityContext.ProcessReliabilitySegmentFromPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+        // Drain up to a full batch of datagrams directly into the pooled buffers
+        numPackets = m_ClientSocket.ReceiveBatch(m_ReceivePackets.data(), numSlots);
 
+        for (int iteration{ 0 }; iteration < numPackets; iteration++)
+        {
+            PacketHandle& packet = m_ReceivePackets[iteration];
+            HandlePacket(packet.GetSender(), packet.GetBuffer(), packet.GetSize(), packet);
 
-            switch (type)
-            {
-            case PacketType::KeepAlive:
-                continue;
-            case PacketType::Message:
+            // Buffers the application kept are replaced, the rest are reused
+            if (packet.IsShared())
             {
-                bool valid = isValidCString((char*)buffer + k_PacketHeaderSize);
-                if (!valid)
-                {
-                    TSLogger::Log("Buffer could not be converted into a c-string\n");
-                    continue;
-                }
-
-                TSLogger::Log("[%i.%i.%i.%i:%i]: ", sender.GetA(), sender.GetB(),
-                    sender.GetC(), sender.GetD(), sender.GetPort());
-                TSLogger::Log("%s", buffer + k_PacketHeaderSize);
-                TSLogger::Log("\n");
-                break;
-            }
-            default:
-                TSLogger::Log("Invalid packet ID obtained");
-                continue;;
+                packet.Reset();
             }
         }
-    } while (bytes_read > 0);
-    
-    // Suspend the thread until an event occurs
-    m_NetworkThread.SuspendThread(true);
-
-    // process packet
+    } while (numPackets == numSlots);
 }
 
-void Client::RunNetworkEventThread()
+void Client::HandlePacket(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket)
 {
-    DWORD waitResult = WaitForMultipleObjects(2, allEvents, FALSE, INFINITE);
+    if (size < (int)k_PacketHeaderSize)
+    {
+        return;
+    }
 
-    if (waitResult == WAIT_OBJECT_0)  // Network event
+    // Check for a valid app ID
+    if (*(AppID*)buffer != m_Config.m_AppProtocolID)
     {
-        WSANETWORKEVENTS netEvents;
-        WSAEnumNetworkEvents(m_ClientSocket.GetHandle(), hNetworkEvent, &netEvents);
+        TSLogger::Log("Failed to validate the app ID from packet\n");
+        return;
+    }
 
-        if (netEvents.lNetworkEvents & FD_READ)
+    // Compressed packets are expanded and handled again, their messages are copied into the pool
+    //      when delivered
+    if (buffer[sizeof(AppID)] & k_CompressedPacketFlag)
+    {
+        int decompressedSize = m_PacketCompressor.DecompressPacket(buffer, size, m_DecompressedPacket.data());
+        if (decompressedSize == 0)
         {
-            m_NetworkThread.ResumeThread();
+            TSLogger::Log("Failed to decompress packet\n");
+            return;
         }
+        HandlePacket(sender, m_DecompressedPacket.data(), decompressedSize);
+        return;
     }
-    else if (waitResult == WAIT_OBJECT_0 + 1)  // Console input event
+
+    PacketType type = (PacketType)buffer[sizeof(AppID)];
+
+    if (IsConnectionManagementPacket(type))
     {
-        INPUT_RECORD inputRecord;
-        DWORD eventsRead;
+        return;
+    }
 
-        while (true)
-        {
-            DWORD numEvents;
-            if (!GetNumberOfConsoleInputEvents(hInputEvent, &numEvents) || numEvents == 0)
-                break;  // No more events, exit the loop
+    // Drop packets addressed to a different client index (e.g. left over from a previous connection)
+    ClientIndex index = ReadClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)]);
+    if (index != m_ServerConnection.m_ClientIndex)
+    {
+        TSLogger::Log("Dropping packet addressed to client index %d\n", (int)index);
+        return;
+    }
+
+    // Reserve the blocks the packet's messages need before it is acknowledged, packets that can not
+    //      be held are dropped unacknowledged so the server resends them
+    Connection& connection = m_ServerConnection.m_Connection;
+    bool carriesMessages = type == PacketType::Message || type == PacketType::KeepAlive;
+    if (carriesMessages && !connection.ReserveReceiveBlocks(buffer, size, (bool)pooledPacket, m_PacketPool, m_ReassemblyPool))
+    {
+        TSLogger::Log("Receive pools exhausted, dropping packet\n");
+        return;
+    }
 
-            if (ReadConsoleInput(hInputEvent, &inputRecord, 1, &eventsRead))
+    // Process reliability segment and drop duplicated or invalid packets
+    ReliabilityContext& reliabilityContext = connection.m_ReliabilityContext;
+    if (!reliabilityContext.ProcessReliabilitySegmentFromPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]))
+    {
+        return;
+    }
+
+    // Confirm path probes and notify the application of reliable messages carried by newly
+    //      acknowledged packets
+    connection.m_PathMtuContext.OnPacketsAcknowledged(reliabilityContext.GetNewestSentSequence(),
+        reliabilityContext.GetNewlyAcknowledgedField());
+    connection.OnPacketsAcknowledged(reliabilityContext.GetNewestSentSequence(),
+        reliabilityContext.GetNewlyAcknowledgedField(), [&](ChannelType channel, uint16_t messageID)
+        {
+            if (m_DeliveryHandler)
             {
-                if (inputRecord.EventType == KEY_EVENT && inputRecord.Event.KeyEvent.bKeyDown)
-                {
-                    char key = inputRecord.Event.KeyEvent.uChar.AsciiChar;
-                    m_NetworkEventQueue.SubmitEvent(std::make_shared<KeyPressedEvent>(key));
-                    m_NetworkThread.ResumeThread();
-                }
+                m_DeliveryHandler(channel, messageID);
             }
+        });
+
+    switch (type)
+    {
+    case PacketType::KeepAlive:
+    case PacketType::Message:
+    {
+        ReceiveMessages(sender, buffer, size, pooledPacket);
+        return;
+    }
+    case PacketType::PathProbe:
+        // Only the acknowledgement of the probe matters
+        return;
+    default:
+        TSLogger::Log("Invalid packet ID obtained");
+        return;
+    }
+}
+
+void Client::ReceiveMessages(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket)
+{
+    MessageRecord record;
+    int offset{ (int)k_PacketHeaderSize };
+
+    while (offset < size)
+    {
+        int recordSize = ReadMessageRecord(&buffer[offset], size - offset, record);
+        if (recordSize == 0)
+        {
+            TSLogger::Log("Received a malformed message record\n");
+            return;
+        }
+        offset += recordSize;
+
+        m_ServerConnection.m_Connection.ReceiveMessage(record, pooledPacket, [&](const uint8_t* message, int messageSize, const PacketHandle& pooledMessage)
+            {
+                DeliverMessage(sender, buffer, size, pooledPacket, message, messageSize, pooledMessage);
+            });
+    }
+
+    m_ServerConnection.m_Connection.ReleaseReservedBlocks();
+}
+
+void Client::DeliverMessage(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket,
+    const uint8_t* message, int messageSize, const PacketHandle& pooledMessage)
+{
+    // Without a handler the message is logged as text
+    if (!m_MessageHandler)
+    {
+        const char* text = (const char*)message;
+        if (messageSize <= 0 || text[messageSize - 1] != '\0' || !isValidCString(text))
+        {
+            TSLogger::Log("Buffer could not be converted into a c-string\n");
+            return;
+        }
+
+        TSLogger::Log("[%i.%i.%i.%i:%i]: ", sender.GetA(), sender.GetB(),
+            sender.GetC(), sender.GetD(), sender.GetPort());
+        TSLogger::Log("%s", text);
+        TSLogger::Log("\n");
+        return;
+    }
+
+    // Reliable messages are already held in a pooled block (reserved before their packet was
+    //      acknowledged)
+    if (pooledMessage)
+    {
+        m_MessageHandler(pooledMessage);
+        return;
+    }
+
+    // Hand over a view of the message in the pooled buffer the packet was received in
+    if (pooledPacket && message >= buffer && message + messageSize <= buffer + size)
+    {
+        PacketHandle messagePacket{ pooledPacket };
+        messagePacket.SetPayload((int)(message - buffer), messageSize);
+        m_MessageHandler(messagePacket);
+        return;
+    }
+
+    // Unreliable messages and snapshots received outside the pool (pool exhausted, or decoded) are
+    //      copied into it, and dropped if it is exhausted
+    PacketHandle messagePacket = m_PacketPool.Acquire();
+    if (!messagePacket)
+    {
+        TSLogger::Log("Packet pool exhausted, dropping message\n");
+        return;
+    }
+
+    memcpy(messagePacket.GetBuffer() + k_PacketHeaderSize, message, messageSize);
+    messagePacket.SetContents(sender, (int)k_PacketHeaderSize + messageSize);
+    m_MessageHandler(messagePacket);
+}
+
+void Client::SubmitConsoleInput()
+{
+    char keys[64];
+    int numKeys = m_Reactor.ReadConsoleKeys(keys, sizeof(keys));
+
+    for (int iteration{ 0 }; iteration < numKeys; iteration++)
+    {
+        if (!m_NetworkEventQueue.SubmitEvent(KeyPressedEvent(keys[iteration])))
+        {
+            TSLogger::Log("Event queue full, dropping console input\n");
         }
     }
 }
@@ -224,75 +373,136 @@ bool Client::HandleConsoleInput(KeyPressedEvent event)
     }
     if (key == 13)
     {
-        SendToServer(PacketType::Message, text.data(), (int)strlen(text.data()) + 1);
+        SendMessageToServer(ChannelType::ReliableOrdered, text.data(), (int)strlen(text.data()) + 1);
         text.clear();
     }
     
     return true;
 }
 
-void Client::OnEvent(Event* event)
+void Client::OnEvent(const AppUpdateEvent&)
 {
     Connection& connection = m_ServerConnection.m_Connection;
     ReliabilityContext& reliableContext = connection.m_ReliabilityContext;
 
-    if (event->GetEventType() == EventType::AppUpdate)
+    // Pack the messages queued since the last update into as few packets as possible, fragmented
+    //      messages are written into as many packets as they need
+    float resendDelay = reliableContext.GetResendDelay();
+    if (m_OutboxPending)
     {
-        // Handle sync pings
-        if (m_KeepAliveTimer.CheckForUpdate(m_NetworkThreadTimer.GetConstantFrameTime()))
+        do
         {
-            if (connection.m_ReliabilityContext.m_CongestionContext.IsCongested())
-            {
-                static uint32_t s_CongestionCounter{ 0 };
-                if (s_CongestionCounter % 3 == 0)
-                {
-                    // Send synchronization pings
-                    SendToServer(PacketType::KeepAlive, nullptr, 0);
-                }
-                s_CongestionCounter++;
-            }
-            else
+            SendToServer(PacketType::Message, nullptr, 0);
+        } while (connection.HasMessagesToSend(resendDelay));
+        m_OutboxPending = false;
+    }
+
+    // Handle sync pings
+    if (m_KeepAliveTimer.CheckForUpdate(m_NetworkThreadTimer.GetConstantFrameTime()))
+    {
+        // Any sequenced packet sent during the interval already kept the connection alive
+        if (m_SentSinceKeepAlive)
+        {
+            m_SentSinceKeepAlive = false;
+        }
+        else if (connection.m_ReliabilityContext.m_CongestionContext.IsCongested())
+        {
+            static uint32_t s_CongestionCounter{ 0 };
+            if (s_CongestionCounter % 3 == 0)
             {
+                // Send synchronization pings
                 SendToServer(PacketType::KeepAlive, nullptr, 0);
+                m_SentSinceKeepAlive = false;
             }
+            s_CongestionCounter++;
         }
-
-        // Increment time since last sync ping for server connection
-        reliableContext.OnUpdate(m_NetworkThreadTimer.GetConstantFrameTimeFloat());
-
-        if (reliableContext.m_LastPacketReceived > m_Config.m_ConnectionTimeout)
+        else
         {
-            m_ServerConnection.Terminate();
-            m_NetworkThread.StopThread(true);
-            TSLogger::Log("Connection closed\n");
-            return;
+            SendToServer(PacketType::KeepAlive, nullptr, 0);
+            m_SentSinceKeepAlive = false;
         }
+    }
 
-        
+    // Send a few packets for resends that are due (e.g. lost fragments)
+    for (int packetCount{ 0 }; packetCount < k_MaxResendPacketsPerTick && connection.HasMessagesToSend(resendDelay); packetCount++)
+    {
+        SendToServer(PacketType::Message, nullptr, 0);
+    }
+
+    // Probe the path for a larger packet size until the search is done
+    PathMtuContext& pathMtuContext = connection.m_PathMtuContext;
+    uint16_t probeSize = pathMtuContext.GetProbeSize(reliableContext.m_RoundTripContext.GetAverageRoundTrip());
+    if (probeSize != 0)
+    {
+        SendToServer(PacketType::PathProbe, nullptr, probeSize);
+        pathMtuContext.OnProbeSent(probeSize, reliableContext.GetNewestSentSequence());
     }
-    else if (event->GetEventType() == EventType::KeyPressed)
+
+    // Increment time since last sync ping for server connection
+    reliableContext.OnUpdate(m_NetworkThreadTimer.GetConstantFrameTimeFloat());
+
+    // A stalled reassembly also closes the connection, its received fragments were already
+    //      acknowledged so the message can not be dropped
+    bool reassemblyStalled = connection.IsReassemblyStalled(m_Config.m_ReassemblyTimeout);
+    if (reassemblyStalled)
     {
-        // Handle any input events from the console
-        HandleConsoleInput(*(KeyPressedEvent*)event);
+        TSLogger::Log("Reassembly timed out\n");
+    }
+
+    if (reliableContext.m_LastPacketReceived > m_Config.m_ConnectionTimeout || reassemblyStalled)
+    {
+        m_ServerConnection.Terminate();
+        m_NetworkThread.StopThread(true);
+        TSLogger::Log("Connection closed\n");
         return;
     }
+}
 
-    
+void Client::OnEvent(const KeyPressedEvent& event)
+{
+    // Handle any input events from the console
+    HandleConsoleInput(event);
+}
+
+bool Client::SubmitEvent(const EventVariant& event)
+{
+    if (!m_NetworkEventQueue.SubmitEvent(event))
+    {
+        return false;
+    }
+
+    m_Reactor.Wake();
+    return true;
 }
 
-void Client::SubmitEvent(Ref<Event> event)
+void Client::SetMessageHandler(ClientMessageFn handler)
 {
-    m_NetworkEventQueue.SubmitEvent(event);
+    m_MessageHandler = handler;
+}
 
-    m_NetworkEventThread.ResumeThread();
+void Client::SetDeliveryHandler(ClientDeliveryFn handler)
+{
+    m_DeliveryHandler = handler;
 }
 
 void Client::RequestConnection()
 {
     ReliabilityContext& reliabilityContext = m_ServerConnection.m_Connection.m_ReliabilityContext;
 
+    // Block until the request timer ticks or a response arrives
+    BitField<uint8_t> readyEvents = m_Reactor.Wait();
+
+    if (readyEvents.IsFlagSet(ReactorEvent::SocketReadable))
+    {
+        ReceiveConnectionResponse();
+        if (!m_NetworkThread.IsRunning())
+        {
+            return;
+        }
+    }
+
     // Check for a network update
-    if (!m_NetworkThreadTimer.CheckForUpdate())
+    if (!readyEvents.IsFlagSet(ReactorEvent::TimerTick) || !m_NetworkThreadTimer.CheckForUpdate())
     {
         return;
     }
@@ -301,7 +511,7 @@ void Client::RequestConnection()
     if (m_RequestConnectionTimer.CheckForUpdate(m_NetworkThreadTimer.GetConstantFrameTime()))
     {
         // Send connection request
-        SendToServer(PacketType::ConnectionRequest, nullptr, 0);
+        SendConnectionRequest();
     }
 
     // Increment time since start of connection attempt
@@ -312,7 +522,10 @@ void Client::RequestConnection()
         m_NetworkThread.StopThread(true);
         return;
     }
+}
 
+void Client::ReceiveConnectionResponse()
+{
     Address sender;
     unsigned char buffer[k_MaxPacketSize];
     int bytes_read{ 0 };
@@ -332,7 +545,7 @@ void Client::RequestConnection()
             // Get packet type
             PacketType type = (PacketType)buffer[sizeof(AppID)];
 
-            ClientIndex index = (ClientIndex)buffer[sizeof(AppID) + sizeof(PacketType)];
+            ClientIndex index = ReadClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)]);
 
             if (!IsConnectionManagementPacket(type))
             {
@@ -341,6 +554,17 @@ void Client::RequestConnection()
 
             if (type == PacketType::ConnectionSuccess)
             {
+                if (bytes_read < (int)(k_PacketHeaderSize + k_ConnectionSuccessSize))
+                {
+                    TSLogger::Log("Received a malformed connection success packet\n");
+                    continue;
+                }
+
+                // Probe the path up to the maximum packet size the server agreed on
+                uint16_t maxPacketSize = ReadUInt16(&buffer[k_PacketHeaderSize]);
+                maxPacketSize = std::clamp(maxPacketSize, (uint16_t)k_MinPacketSize, m_Config.m_MaxPacketSize);
+                m_ServerConnection.m_Connection.m_PathMtuContext.Init(maxPacketSize);
+
                 m_ServerConnection.m_Status = ConnectionStatus::Connected;
                 m_ServerConnection.m_ClientIndex = index;
                 TSLogger::Log("Connection successful!\n");
@@ -356,14 +580,27 @@ void Client::RequestConnection()
             }
         }
     } while (bytes_read > 0);
-    
+}
+
+bool Client::SendConnectionRequest()
+{
+    // Send the wire format, reliable window, and compression dictionary so the server can deny a
+    //      mismatch, and the largest packet this client supports
+    uint8_t request[k_ConnectionRequestSize];
+    request[0] = k_ProtocolVersion;
+    WriteUInt16(&request[sizeof(uint8_t)], m_Config.m_ReliableWindowSize);
+    WriteUInt16(&request[sizeof(uint8_t) + sizeof(uint16_t)], m_Config.m_MaxPacketSize);
+    WriteUInt32(&request[sizeof(uint8_t) + 2 * sizeof(uint16_t)], m_PacketCompressor.GetDictionaryID());
+
+    return SendToServer(PacketType::ConnectionRequest, request, sizeof(request));
 }
 
 bool Client::SendToServer(PacketType type, const void* payload, int payloadSize)
 {
     Connection& connection = m_ServerConnection.m_Connection;
 
-    if (payloadSize >= k_MaxPayloadSize)
+    // Path probes pass their datagram size as the payload size
+    if (type == PacketType::PathProbe ? payloadSize > (int)k_MaxPacketSize : payloadSize > (int)k_MaxMessageSize)
     {
         TSLogger::Log("Failed to send packet. Payload exceeds maximum size limit\n");
         return false;
@@ -381,32 +618,84 @@ bool Client::SendToServer(PacketType type, const void* payload, int payloadSize)
    packetTypeLocation = type;
 
    // Send the client connection Index
-   ClientIndex& clientIndexLocation = *(ClientIndex*)&buffer[sizeof(AppID) + sizeof(PacketType)];
-   clientIndexLocation = m_ServerConnection.m_ClientIndex;
+   WriteClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)], m_ServerConnection.m_ClientIndex);
 
-   if (!IsConnectionManagementPacket(type))
+   int packetSize{ (int)k_PacketHeaderSize };
+   if (IsConnectionManagementPacket(type))
    {
-       // Set reliability segment
-       connection.m_ReliabilityContext.InsertReliabilitySegmentIntoPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+       // Management packets carry their payload directly after the header
+       if (payloadSize > 0)
+       {
+           memcpy(&buffer[k_PacketHeaderSize], payload, payloadSize);
+       }
+       packetSize += payloadSize;
    }
-
-   if (payloadSize > 0)
+   else
    {
-       // Set the payload data
-       memcpy(&buffer[k_PacketHeaderSize], payload, payloadSize);
+       // Set reliability segment
+       ReliabilityContext& reliabilityContext = connection.m_ReliabilityContext;
+       reliabilityContext.InsertReliabilitySegmentIntoPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+
+       // Probes carry no messages, they are padded to the probed size
+       if (type == PacketType::PathProbe)
+       {
+           memset(&buffer[k_PacketHeaderSize], 0, payloadSize - k_PacketHeaderSize);
+           return m_ClientSocket.Send(connection.m_Address, buffer, payloadSize);
+       }
+
+       m_SentSinceKeepAlive = true;
+
+       // Pack the queued messages of every channel, leaving room for the payload
+       int payloadRecordSize = payloadSize > 0 ? (int)k_MessageRecordHeaderSize + payloadSize : 0;
+       packetSize += connection.WriteMessages(reliabilityContext.GetNewestSentSequence(), &buffer[packetSize],
+           (int)connection.m_PathMtuContext.GetPacketSize() - packetSize - payloadRecordSize, m_Config.m_ChannelBudgets, reliabilityContext.GetResendDelay());
+
+       // Wrap the payload in an unreliable message record
+       if (payloadSize > 0)
+       {
+           packetSize += WriteMessageRecord(&buffer[packetSize], ChannelType::Unreliable, 0, payload, payloadSize);
+       }
+
+       if (m_Config.m_CompressPackets)
+       {
+           packetSize = m_PacketCompressor.CompressPacket(buffer, packetSize);
+       }
    }
 
    // Send the message
    bool sendSuccess{ false };
-   sendSuccess = m_ClientSocket.Send(connection.m_Address, buffer, payloadSize + k_PacketHeaderSize);
+   sendSuccess = m_ClientSocket.Send(connection.m_Address, buffer, packetSize);
 
    return sendSuccess;
 }
 
+bool Client::SendMessageToServer(ChannelType channel, const void* payload, int payloadSize, uint16_t* messageID)
+{
+    uint16_t queuedMessageID;
+    if (!m_ServerConnection.m_Connection.QueueMessage(channel, payload, payloadSize, queuedMessageID))
+    {
+        TSLogger::Log("Failed to send message. Payload exceeds maximum size limit or the channel is full\n");
+        return false;
+    }
+
+    if (messageID)
+    {
+        *messageID = queuedMessageID;
+    }
+
+    // The message waits in the outbox and is coalesced with the other messages queued during this
+    //      tick on the next update
+    m_OutboxPending = true;
+
+    return true;
+}
+
 void ConnectionToServer::Init(const NetworkConfig& config)
 {
     m_Connection.m_Address = config.m_ServerAddress;
     m_Connection.m_ReliabilityContext.m_LastPacketReceived = 0.0f;
+    m_Connection.InitChannels(config.m_ReliableWindowSize);
+    m_Connection.m_PathMtuContext.Init(k_MinPacketSize);
     m_Status = ConnectionStatus::Disconnected;
     m_ClientIndex = k_InvalidClientIndex;
 }
@@ -415,6 +704,7 @@ void ConnectionToServer::Terminate()
 {
     m_Connection.m_Address = Address();
     m_Connection.m_ReliabilityContext.m_LastPacketReceived = 0.0f;
+    m_Connection.ResetChannels();
     m_Status = ConnectionStatus::Disconnected;
     m_ClientIndex = k_InvalidClientIndex;
 }
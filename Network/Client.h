@@ -2,12 +2,23 @@
 
 #include "../Util/Thread.h"
 #include "../Posix/Socket.h"
+#include "../Posix/NetworkReactor.h"
 #include "NetworkConfig.h"
 #include "../Posix/Connection.h"
+#include "../Posix/PacketCompressor.h"
 #include "../Util/LoopTimer.h"
 #include "../Util/PassiveLoopTimer.h"
 #include "../Util/EventQueue.h"
 
+#include <array>
+#include <functional>
+
+// Called on the network thread with each received message. Copy the handle to keep the buffer.
+using ClientMessageFn = std::function<void(const PacketHandle&)>;
+// Called on the network thread once a reliable message is acknowledged by the server (message IDs
+//		are per channel)
+using ClientDeliveryFn = std::function<void(ChannelType, uint16_t messageID)>;
+
 enum ConnectionStatus : uint8_t
 {
 	Disconnected,
@@ -53,42 +64,78 @@ public:
 	//==============================
 	// On Event
 	//==============================
-	void OnEvent(Event* event);
+	// Visited with the concrete type of each queued event
+	void OnEvent(const AppUpdateEvent& event);
+	void OnEvent(const KeyPressedEvent& event);
 
 	//==============================
 	// Manage Events
 	//==============================
-	void SubmitEvent(Ref<Event> event);
+	// Returns false if the event queue is bounded and full
+	bool SubmitEvent(const EventVariant& event);
+	// Hand received messages to the application (set before InitClient). Messages are logged if unset.
+	void SetMessageHandler(ClientMessageFn handler);
+	// Notify the application when reliable messages are acknowledged (set before InitClient)
+	void SetDeliveryHandler(ClientDeliveryFn handler);
 private:
 	// Manage the server connection
 	void RequestConnection();
+	bool SendConnectionRequest();
+	void ReceiveConnectionResponse();
 public:
 	//==============================
 	// Run Threads
 	//==============================
 	// Run socket/packet handling thread
 	void RunNetworkThread();
-	void RunNetworkEventThread();
 
 private:
+	// Handle a single received datagram. The pooled packet is valid when the buffer was received
+	//		directly into the packet pool.
+	void HandlePacket(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket = {});
+	// Deliver each message record of a sequenced packet
+	void ReceiveMessages(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket);
+	void DeliverMessage(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket,
+		const uint8_t* message, int messageSize, const PacketHandle& pooledMessage);
 	// Helper functions
 	bool HandleConsoleInput(KeyPressedEvent event);
+	void SubmitConsoleInput();
 public:
 	//==============================
 	// Send Packets
 	//==============================
 	bool SendToServer(PacketType type, const void* payload, int payloadSize);
+	// Queue a message on a channel, the messages queued during a tick are packed together on the
+	//		next update. Reliable channels resend it until acknowledged and report the optional
+	//		message ID to the delivery handler.
+	//		Messages on the Snapshot channel are replicated state, only the newest one is sent.
+	bool SendMessageToServer(ChannelType channel, const void* payload, int payloadSize, uint16_t* messageID = nullptr);
 private:
 	//==============================
 	// Internal Data
 	//==============================
 	Socket m_ClientSocket;
+	PacketBatch m_ReceiveBatch;
+	PacketPool m_PacketPool;
+	// Blocks that fragmented messages are reassembled in
+	PacketPool m_ReassemblyPool;
+	// Compresses sent packets and expands received ones into m_DecompressedPacket
+	PacketCompressor m_PacketCompressor;
+	std::array<uint8_t, k_MaxPacketSize> m_DecompressedPacket{};
+	std::array<PacketHandle, k_MaxPacketBatchSize> m_ReceivePackets{};
+	ClientMessageFn m_MessageHandler{ nullptr };
+	ClientDeliveryFn m_DeliveryHandler{ nullptr };
+	NetworkReactor m_Reactor;
 	KGThread m_NetworkThread;
-	KGThread m_NetworkEventThread;
 	NetworkConfig m_Config;
 	LoopTimer m_NetworkThreadTimer;
 	PassiveLoopTimer m_RequestConnectionTimer;
 	PassiveLoopTimer m_KeepAliveTimer;
+	// Messages were queued since the last update
+	bool m_OutboxPending{ false };
+	// A sequenced packet was sent since the last keep-alive interval (which makes the keep-alive
+	//		unnecessary)
+	bool m_SentSinceKeepAlive{ false };
 	EventQueue m_NetworkEventQueue;
 
 	// Server connection
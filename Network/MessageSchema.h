@@ -0,0 +1,131 @@
+#pragma once
+
+#include "NetworkCommon.h"
+#include "../Util/BitStream.h"
+#include "../Util/Base.h"
+
+#include <array>
+#include <cstdint>
+
+//==============================
+// Schema Fields
+//==============================
+// Each field type describes how one value is serialized and the most bits it can take
+//		(k_MaxBits), so a schema's worst case size is known at compile time.
+
+struct BoolField
+{
+	using ValueType = bool;
+	static constexpr int k_MaxBits{ 1 };
+
+	static void Write(BitWriter& writer, bool value) { writer.WriteBool(value); }
+	static bool Read(BitReader& reader, bool& value) { return reader.ReadBool(value); }
+};
+
+// Integer in [MinValue, MaxValue], stored with the bits its range requires
+template<int32_t MinValue, int32_t MaxValue>
+struct IntegerField
+{
+	static_assert(MinValue <= MaxValue, "IntegerField requires MinValue <= MaxValue");
+
+	using ValueType = int32_t;
+	static constexpr int k_MaxBits{ GetBitsRequired((uint32_t)((int64_t)MaxValue - MinValue)) };
+
+	static void Write(BitWriter& writer, int32_t value) { writer.WriteInteger(value, MinValue, MaxValue); }
+	static bool Read(BitReader& reader, int32_t& value) { return reader.ReadInteger(value, MinValue, MaxValue); }
+};
+
+// Float clamped to [MinValue, MaxValue] and quantized to StepsPerUnit steps per unit (a
+//		resolution of 1 / StepsPerUnit)
+template<int32_t MinValue, int32_t MaxValue, uint32_t StepsPerUnit>
+struct FloatField
+{
+	static_assert(MinValue < MaxValue && StepsPerUnit > 0, "FloatField requires MinValue < MaxValue and StepsPerUnit > 0");
+	static_assert(((int64_t)MaxValue - MinValue) * StepsPerUnit <= UINT32_MAX, "FloatField has too many steps");
+
+	using ValueType = float;
+	static constexpr uint32_t k_NumSteps{ (uint32_t)(((int64_t)MaxValue - MinValue) * StepsPerUnit) };
+	static constexpr int k_MaxBits{ GetBitsRequired(k_NumSteps) };
+
+	static void Write(BitWriter& writer, float value)
+	{
+		writer.WriteFloat(value, (float)MinValue, (float)MaxValue, k_NumSteps);
+	}
+	static bool Read(BitReader& reader, float& value)
+	{
+		return reader.ReadFloat(value, (float)MinValue, (float)MaxValue, k_NumSteps);
+	}
+};
+
+// Up to MaxCount values of another field, preceded by their count
+template<typename ElementField, uint16_t MaxCount>
+struct ArrayField
+{
+	struct ValueType
+	{
+		std::array<typename ElementField::ValueType, MaxCount> m_Values{};
+		uint16_t m_Count{ 0 };
+	};
+	static constexpr int k_MaxBits{ GetBitsRequired(MaxCount) + MaxCount * ElementField::k_MaxBits };
+
+	static void Write(BitWriter& writer, const ValueType& value)
+	{
+		KG_ASSERT(value.m_Count <= MaxCount);
+		writer.WriteBits(value.m_Count, GetBitsRequired(MaxCount));
+		for (uint16_t index{ 0 }; index < value.m_Count; index++)
+		{
+			ElementField::Write(writer, value.m_Values[index]);
+		}
+	}
+	static bool Read(BitReader& reader, ValueType& value)
+	{
+		uint32_t count{ 0 };
+		if (!reader.ReadBits(count, GetBitsRequired(MaxCount)) || count > MaxCount)
+		{
+			return false;
+		}
+
+		value.m_Count = (uint16_t)count;
+		for (uint16_t index{ 0 }; index < value.m_Count; index++)
+		{
+			if (!ElementField::Read(reader, value.m_Values[index]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+//==============================
+// Message Schema
+//==============================
+// Fixed list of fields serialized in order. The worst case size is checked at compile time to fit
+//		a message record of any channel, so a serialized message can always be sent.
+//		Serialization does not allocate, e.g.
+//			using MoveSchema = MessageSchema<IntegerField<0, 255>, FloatField<-512, 512, 64>, BoolField>;
+//			uint8_t buffer[MoveSchema::k_MaxSize];
+//			int size = MoveSchema::Serialize(buffer, sizeof(buffer), entityID, positionX, isRunning);
+template<typename... Fields>
+struct MessageSchema
+{
+	static constexpr int k_MaxBits{ (0 + ... + Fields::k_MaxBits) };
+	static constexpr int k_MaxSize{ (k_MaxBits + 7) / 8 };
+	static_assert(k_MaxSize <= (int)k_MaxSequencedMessageSize, "MessageSchema does not fit a message record");
+
+	// Returns the number of bytes written, or 0 if the buffer is too small
+	static int Serialize(uint8_t* buffer, int capacity, const typename Fields::ValueType&... values)
+	{
+		BitWriter writer{ buffer, capacity };
+		(Fields::Write(writer, values), ...);
+		int size = writer.Finish();
+		return writer.HasOverflowed() ? 0 : size;
+	}
+
+	// Returns false if the data is too short or a value is out of its field's range
+	static bool Deserialize(const uint8_t* data, int size, typename Fields::ValueType&... values)
+	{
+		BitReader reader{ data, size };
+		return (Fields::Read(reader, values) && ...);
+	}
+};
@@ -1,20 +1,41 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <cstddef>
 #include <limits>
+#include <cstring>
 
 using AppID = uint8_t;
-using ClientIndex = uint8_t;
+using ClientIndex = uint16_t;
 
 constexpr ClientIndex k_InvalidClientIndex{ std::numeric_limits<ClientIndex>::max() };
 
+// Wire format version sent as the connection request payload. The server denies clients with a
+//		different version (version 1 widened the client index to 16 bits, version 2 packs the
+//		payload of sequenced packets into message records, version 3 adds the ordered channel and
+//		sends the reliable window size with the version, version 4 adds the unreliable-sequenced
+//		channel, version 5 adds fragment records, version 6 negotiates the packet size and adds
+//		path probes, version 7 adds the snapshot channel, version 8 stores the reliability segment
+//		in network byte order, version 9 adds compressed packets and the dictionary ID).
+constexpr uint8_t k_ProtocolVersion{ 9 };
+
+// Connection request payload (protocolVersion|reliableWindowSize|maxPacketSize|compressionDictionaryID)
+constexpr size_t k_ConnectionRequestSize{ sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) };
+// Connection success payload (negotiated maxPacketSize)
+constexpr size_t k_ConnectionSuccessSize{ sizeof(uint16_t) };
+
 enum class PacketType : uint8_t
 {
 	KeepAlive,
 	Message,
 	ConnectionRequest,
 	ConnectionSuccess,
-	ConnectionDenied
+	ConnectionDenied,
+	// Sequenced packet padded to the size being probed, its payload is ignored
+	PathProbe
 };
+// Set in the packet type byte of sequenced packets whose payload is compressed
+constexpr uint8_t k_CompressedPacketFlag{ 0x80 };
 
 constexpr size_t k_ReliabilitySegmentSize
 {
@@ -29,8 +50,60 @@ constexpr size_t k_PacketHeaderSize
 	sizeof(ClientIndex) + /*clientIndex*/
 	k_ReliabilitySegmentSize /*packetAckSegment*/
 };
-constexpr size_t k_MaxPacketSize{ 256 };
-constexpr size_t k_MaxPayloadSize{ k_MaxPacketSize - k_PacketHeaderSize };
+// Connections start at k_MinPacketSize, which every path is assumed to carry, and may grow up to
+//		k_MaxPacketSize (an Ethernet MTU minus the IPv4 and UDP headers) through path MTU discovery.
+//		Buffers are sized for k_MaxPacketSize. Message size limits follow k_MinPacketSize, so any
+//		message fits a packet of any connection.
+constexpr size_t k_MinPacketSize{ 256 };
+constexpr size_t k_MaxPacketSize{ 1472 };
+constexpr size_t k_MaxPayloadSize{ k_MinPacketSize - k_PacketHeaderSize };
+
+// The payload of sequenced packets (KeepAlive and Message) is a list of message records
+//		(channel|[messageID]|size|data). Every channel except Unreliable carries a message ID, so
+//		reliable messages that are resent in later packets and stale sequenced messages can be
+//		recognized by the receiver. Message IDs are counted per channel.
+enum class ChannelType : uint8_t
+{
+	Unreliable,
+	Reliable,
+	ReliableOrdered,
+	// Unreliable, but messages older than the newest one received are dropped
+	UnreliableSequenced,
+	// Replicated state, delta encoded against the newest snapshot the receiver acknowledged (the
+	//		message ID is the snapshot ID)
+	Snapshot
+};
+constexpr size_t k_NumChannelTypes{ 5 };
+
+// Bytes of each packet a channel may fill, indexed by ChannelType
+using ChannelBudgets = std::array<uint16_t, k_NumChannelTypes>;
+
+constexpr size_t k_MessageRecordHeaderSize
+{
+	sizeof(ChannelType) /*channel*/ +
+	sizeof(uint16_t) /*messageSize*/
+};
+constexpr size_t k_SequencedRecordHeaderSize
+{
+	k_MessageRecordHeaderSize +
+	sizeof(uint16_t) /*messageID*/
+};
+constexpr size_t k_MaxMessageSize{ k_MaxPayloadSize - k_MessageRecordHeaderSize };
+constexpr size_t k_MaxSequencedMessageSize{ k_MaxPayloadSize - k_SequencedRecordHeaderSize };
+
+// Reliable messages larger than a packet are split into fragment records, which set the high bit
+//		of the channel byte and start their data with the fragment's position
+//		(channel|messageID|size|fragmentIndex|fragmentCount|data). Every fragment except the last
+//		carries exactly k_FragmentSize bytes.
+constexpr uint8_t k_FragmentRecordFlag{ 0x80 };
+constexpr size_t k_FragmentHeaderSize
+{
+	sizeof(uint16_t) /*fragmentIndex*/ +
+	sizeof(uint16_t) /*fragmentCount*/
+};
+constexpr size_t k_FragmentSize{ k_MaxSequencedMessageSize - k_FragmentHeaderSize };
+constexpr size_t k_MaxFragmentedMessageSize{ 64 * 1024 };
+constexpr size_t k_MaxFragmentsPerMessage{ (k_MaxFragmentedMessageSize + k_FragmentSize - 1) / k_FragmentSize };
 
 inline bool IsConnectionManagementPacket(PacketType type)
 {
@@ -43,4 +116,136 @@ inline bool IsConnectionManagementPacket(PacketType type)
 	default:
 		return false;
 	}
-}
\ No newline at end of file
+}
+
+// The client index is stored in network byte order so it can be read by the shard steering program
+inline ClientIndex ReadClientIndex(const uint8_t* location)
+{
+	return (ClientIndex)((location[0] << 8) | location[1]);
+}
+
+inline void WriteClientIndex(uint8_t* location, ClientIndex clientIndex)
+{
+	location[0] = (uint8_t)(clientIndex >> 8);
+	location[1] = (uint8_t)(clientIndex & 0xFF);
+}
+
+// Multi-byte record fields are stored in network byte order
+inline uint16_t ReadUInt16(const uint8_t* location)
+{
+	return (uint16_t)((location[0] << 8) | location[1]);
+}
+
+inline void WriteUInt16(uint8_t* location, uint16_t value)
+{
+	location[0] = (uint8_t)(value >> 8);
+	location[1] = (uint8_t)(value & 0xFF);
+}
+
+inline uint32_t ReadUInt32(const uint8_t* location)
+{
+	return ((uint32_t)ReadUInt16(location) << 16) | ReadUInt16(&location[sizeof(uint16_t)]);
+}
+
+inline void WriteUInt32(uint8_t* location, uint32_t value)
+{
+	WriteUInt16(location, (uint16_t)(value >> 16));
+	WriteUInt16(&location[sizeof(uint16_t)], (uint16_t)(value & 0xFFFF));
+}
+
+struct MessageRecord
+{
+	ChannelType m_Channel{ ChannelType::Unreliable };
+	uint16_t m_MessageID{ 0 };
+	const uint8_t* m_Data{ nullptr };
+	int m_Size{ 0 };
+	// Fragment records only (m_FragmentCount is 0 for whole messages)
+	uint16_t m_FragmentIndex{ 0 };
+	uint16_t m_FragmentCount{ 0 };
+};
+
+inline int GetMessageRecordHeaderSize(ChannelType channel)
+{
+	return channel == ChannelType::Unreliable ? (int)k_MessageRecordHeaderSize : (int)k_SequencedRecordHeaderSize;
+}
+
+inline int GetMaxMessageSize(ChannelType channel)
+{
+	return channel == ChannelType::Unreliable ? (int)k_MaxMessageSize : (int)k_MaxSequencedMessageSize;
+}
+
+// Returns the number of bytes written. The data may be left out (nullptr) and appended by the caller.
+inline int WriteMessageRecord(uint8_t* location, ChannelType channel, uint16_t messageID, const void* data, int size)
+{
+	location[0] = (uint8_t)channel;
+	int headerSize = GetMessageRecordHeaderSize(channel);
+	if (channel != ChannelType::Unreliable)
+	{
+		WriteUInt16(&location[sizeof(ChannelType)], messageID);
+	}
+	WriteUInt16(&location[headerSize - sizeof(uint16_t)], (uint16_t)size);
+
+	if (data && size > 0)
+	{
+		memcpy(&location[headerSize], data, size);
+	}
+	return headerSize + size;
+}
+
+// Returns the number of bytes written
+inline int WriteFragmentRecord(uint8_t* location, ChannelType channel, uint16_t messageID,
+	uint16_t fragmentIndex, uint16_t fragmentCount, const void* data, int size)
+{
+	int headerSize = GetMessageRecordHeaderSize(channel);
+	WriteMessageRecord(location, channel, messageID, nullptr, (int)k_FragmentHeaderSize + size);
+	location[0] |= k_FragmentRecordFlag;
+
+	uint8_t* fragmentHeader = &location[headerSize];
+	WriteUInt16(fragmentHeader, fragmentIndex);
+	WriteUInt16(&fragmentHeader[sizeof(uint16_t)], fragmentCount);
+	memcpy(&fragmentHeader[k_FragmentHeaderSize], data, size);
+	return headerSize + (int)k_FragmentHeaderSize + size;
+}
+
+// Returns the number of bytes the record occupies, or 0 if it is malformed
+inline int ReadMessageRecord(const uint8_t* location, int available, MessageRecord& record)
+{
+	uint8_t channel = available > 0 ? (uint8_t)(location[0] & ~k_FragmentRecordFlag) : 0;
+	if (available < (int)k_MessageRecordHeaderSize || channel >= (uint8_t)k_NumChannelTypes)
+	{
+		return 0;
+	}
+
+	record.m_Channel = (ChannelType)channel;
+	int headerSize = GetMessageRecordHeaderSize(record.m_Channel);
+	if (available < headerSize)
+	{
+		return 0;
+	}
+
+	record.m_MessageID = record.m_Channel != ChannelType::Unreliable ? ReadUInt16(&location[sizeof(ChannelType)]) : 0;
+	record.m_Size = ReadUInt16(&location[headerSize - sizeof(uint16_t)]);
+	record.m_Data = &location[headerSize];
+	if (available - headerSize < record.m_Size)
+	{
+		return 0;
+	}
+	int recordSize = headerSize + record.m_Size;
+
+	// Fragments are only sent on the reliable channels
+	record.m_FragmentIndex = 0;
+	record.m_FragmentCount = 0;
+	if (location[0] & k_FragmentRecordFlag)
+	{
+		if ((record.m_Channel != ChannelType::Reliable && record.m_Channel != ChannelType::ReliableOrdered) ||
+			record.m_Size < (int)k_FragmentHeaderSize)
+		{
+			return 0;
+		}
+		record.m_FragmentIndex = ReadUInt16(record.m_Data);
+		record.m_FragmentCount = ReadUInt16(&record.m_Data[sizeof(uint16_t)]);
+		record.m_Data += k_FragmentHeaderSize;
+		record.m_Size -= (int)k_FragmentHeaderSize;
+	}
+	return recordSize;
+}
@@ -2,6 +2,8 @@
 #include "../Posix/Address.h"
 #include "NetworkCommon.h"
 
+#include <vector>
+
 struct NetworkConfig
 {
 	AppID m_AppProtocolID{ 0 };
@@ -9,5 +11,41 @@ struct NetworkConfig
 	float m_ConnectionTimeout{ 10.0f };
 	float m_SyncPingFrequency{ 0.05f };
 	float m_RequestConnectionFrequency{ 1.0f };
+	// Maximum number of server connections, split evenly between the shards (storage for every
+	//		connection is preallocated, must be less than k_InvalidClientIndex)
+	ClientIndex m_MaxClients{ 64 };
+	// Number of pooled packet buffers that received messages are handed to the application in
+	uint32_t m_PacketPoolCapacity{ 1024 };
+	// Number of fragmented messages that may be reassembled at once (each takes a block of
+	//		k_ReassemblyBlockSize bytes), and the time a reassembly may wait on its next fragment
+	//		before the connection is closed
+	uint32_t m_ReassemblyPoolCapacity{ 16 };
+	float m_ReassemblyTimeout{ 5.0f };
+	// Capacity of the network thread's event queue. Bounded queues store events inline without
+	//		allocating and SubmitEvent fails while they are full. 0 is unbounded (allocates per event).
+	uint32_t m_EventQueueCapacity{ 1024 };
+	// Receive coalesced datagrams with UDP GRO (Linux only), ignored when io_uring is used
+	bool m_ReceiveCoalescing{ false };
+	// Use the io_uring socket backend when available (Linux only)
+	bool m_UseIoUring{ false };
+	// Number of SO_REUSEPORT server shards (one socket/thread/connection slice each)
+	uint8_t m_NumServerShards{ 1 };
+	// Maximum number of reliable messages in flight per channel and direction (a power of two up to
+	//		k_MaxReliableWindowSize). Sent with the connection request, the server denies a mismatch.
+	uint16_t m_ReliableWindowSize{ 64 };
+	// Bytes of each outgoing packet a channel may fill (indexed by ChannelType). Channels are
+	//		written reliable-ordered, reliable, unreliable-sequenced, then unreliable, so lowering
+	//		the budgets of the earlier channels keeps room for the later ones. A channel may always
+	//		write its first message.
+	ChannelBudgets m_ChannelBudgets{ k_MaxPacketSize, k_MaxPacketSize, k_MaxPacketSize, k_MaxPacketSize, k_MaxPacketSize };
+	// Largest datagram this end sends or accepts (k_MinPacketSize to k_MaxPacketSize). Connections
+	//		use the smaller maximum of both ends and probe the path up to it.
+	uint16_t m_MaxPacketSize{ 1200 };
+	// Compress the payload of sent packets when it makes them smaller. Compressed packets are
+	//		always accepted, both ends must use the same dictionary (checked on connection). The
+	//		dictionary is trained offline on captured traffic, an empty one still compresses
+	//		repetition within a packet.
+	bool m_CompressPackets{ false };
+	std::vector<uint8_t> m_CompressionDictionary{};
 };
 
@@ -2,20 +2,20 @@
 #include "../Util/Helper.h"
 #include "../Util/StringOperations.h"
 
-#include <conio.h>
+#include <cmath>
+#include <cstring>
 #include <queue>
+#include <algorithm>
 #include <atomic>
 
 
-static HANDLE hNetworkEvent;
-static HANDLE hInputEvent;
-static HANDLE allEvents[2];
-static std::string text;
-
-bool Server::InitServer(const NetworkConfig& initConfig)
+bool Server::InitServer(const NetworkConfig& initConfig, uint8_t shardIndex)
 {
     // Set config
     m_Config = initConfig;
+    m_ShardIndex = shardIndex;
+    KG_ASSERT(m_Config.m_NumServerShards > 0 && shardIndex < m_Config.m_NumServerShards);
+    KG_ASSERT(m_Config.m_MaxPacketSize >= k_MinPacketSize && m_Config.m_MaxPacketSize <= k_MaxPacketSize);
 
     // Initialize the OS specific socket context
     if (!SocketContext::InitializeSockets())
@@ -25,52 +25,85 @@ bool Server::InitServer(const NetworkConfig& initConfig)
     }
 
     // Open the server socket
-    if (!m_ServerSocket.Open(initConfig.m_ServerAddress.GetPort()))
+    // Shards share the same port, the kernel distributes incoming datagrams between their sockets
+    if (!m_ServerSocket.Open(initConfig.m_ServerAddress.GetPort(), m_Config.m_NumServerShards > 1))
     {
         TSLogger::Log("Failed to create socket!\n");
         SocketContext::ShutdownSockets();
         return false;
     }
 
-    m_NetworkEventQueue.Init(KG_BIND_CLASS_FN(OnEvent));
+    // Path probes must be dropped rather than fragmented when they exceed the path
+    m_ServerSocket.EnablePathMtuProbing();
+
+    // Optionally use the io_uring backend (falls back to the regular socket calls if unavailable)
+    m_UseIoUring = m_Config.m_UseIoUring && m_UringSocket.Init(m_ServerSocket);
 
-    // TODO: Move this please for the love of god
-    // Create network event
-    hNetworkEvent = WSACreateEvent();
-    if (WSAEventSelect(m_ServerSocket.GetHandle(), hNetworkEvent, FD_READ) != 0)
+    // Optionally let the kernel coalesce datagrams (falls back to batched receives if unavailable)
+    m_ReceiveCoalescing = !m_UseIoUring && m_Config.m_ReceiveCoalescing && m_ServerSocket.EnableReceiveCoalescing();
+    if (m_ReceiveCoalescing)
     {
-        TSLogger::Log("Failed to create the network event handle");
-        return false;
+        m_CoalescedPacket.m_Buffer.resize(k_MaxCoalescedSize);
     }
 
-    // Get console input handle
-    hInputEvent = GetStdHandle(STD_INPUT_HANDLE);
-    SetConsoleMode(hInputEvent, 0);
+    m_NetworkEventQueue.Init(m_Config.m_EventQueueCapacity);
 
-    // Wait for both events
-    allEvents[0] = hNetworkEvent;
-    allEvents[1] = hInputEvent;
+    // Create the pool that received packets are handed to the application in
+    m_PacketPool.Init(m_Config.m_PacketPoolCapacity);
+    m_ReassemblyPool.Init(m_Config.m_ReassemblyPoolCapacity, k_ReassemblyBlockSize);
+    m_PacketCompressor.Init(m_Config.m_CompressionDictionary);
 
-    m_AllConnections = ConnectionList(64);
+    // Create the reactor that the network thread blocks on (socket, events, timer, and console)
+    //      Only the first shard reads from the console
+    int networkHandle = m_UseIoUring ? m_UringSocket.GetCompletionHandle() : m_ServerSocket.GetHandle();
+    if (!m_Reactor.Init(networkHandle, m_ShardIndex == 0))
+    {
+        TSLogger::Log("Failed to initialize the network reactor\n");
+        m_UringSocket.Terminate();
+        SocketContext::ShutdownSockets();
+        return false;
+    }
+
+    // Each shard owns a disjoint slice of the client indices
+    KG_ASSERT(m_Config.m_MaxClients < k_InvalidClientIndex);
+    ClientIndex shardClients = m_Config.m_MaxClients / m_Config.m_NumServerShards;
+    m_AllConnections = ConnectionList(shardClients, (ClientIndex)(shardClients * m_ShardIndex), m_Config.m_ReliableWindowSize);
 
     m_ManageConnections = false;
 
     // Start network thread
     m_ManageConnectionTimer.InitializeTimer();
-    m_KeepAliveTimer.InitializeTimer(m_Config.m_SyncPingFrequency);
+
+    // Connection deadlines are counted in connection management ticks
+    float frameTime = m_ManageConnectionTimer.GetConstantFrameTimeFloat();
+    m_AllConnections.SetTimerIntervals((uint32_t)std::ceil(m_Config.m_ConnectionTimeout / frameTime),
+        (uint32_t)std::ceil(m_Config.m_SyncPingFrequency / frameTime));
     m_NetworkThread.StartThread(KG_BIND_CLASS_FN(RunNetworkThread));
-    m_NetworkEventThread.StartThread(KG_BIND_CLASS_FN(RunNetworkEventThread));
 
     return true;
 }
 
 bool Server::TerminateServer(bool withinNetworkThread)
 {
-    // Join the network thread
-    m_NetworkThread.StopThread(withinNetworkThread);
-    m_NetworkEventThread.StopThread(withinNetworkThread);
+    // Signal the network thread to exit
+    m_NetworkThread.StopThread(true);
+
+    // Wake and join the network thread if it is blocked on the reactor
+    if (!withinNetworkThread)
+    {
+        m_Reactor.Wake();
+        m_NetworkThread.WaitOnThread();
+    }
 
     m_ManageConnections = false;
+    m_Reactor.Terminate();
+    m_UringSocket.Terminate();
+
+    // Return the receive buffers to the pool
+    for (PacketHandle& packet : m_ReceivePackets)
+    {
+        packet.Reset();
+    }
 
     // Clean up socket resources
     SocketContext::ShutdownSockets();
@@ -81,168 +114,326 @@ bool Server::TerminateServer(bool withinNetworkThread)
 void Server::WaitOnServerTerminate()
 {
     m_NetworkThread.WaitOnThread();
-    m_NetworkEventThread.WaitOnThread();
 }
 
 
 void Server::RunNetworkThread()
 {
+    // Block until a packet, submitted event, timer tick, or key press is available
+    BitField<uint8_t> readyEvents = m_Reactor.Wait();
+
+    if (readyEvents.IsFlagSet(ReactorEvent::ConsoleInput))
+    {
+        SubmitConsoleInput();
+    }
+
     // Run functions that manage the upkeep of active client connections
-    if (m_ManageConnections && !ManageConnections())
+    if (m_ManageConnections && readyEvents.IsFlagSet(ReactorEvent::TimerTick))
+    {
+        ManageConnections();
+    }
+
+    m_NetworkEventQueue.ProcessQueue(KG_BIND_CLASS_FN(OnEvent));
+
+    // Handle the server terminating while processing events
+    if (!m_NetworkThread.IsRunning())
     {
         return;
     }
 
-    m_NetworkEventQueue.ProcessQueue();
+    if (readyEvents.IsFlagSet(ReactorEvent::SocketReadable))
+    {
+        ReceivePackets();
+    }
+}
 
-    Address sender;
-    unsigned char buffer[k_MaxPacketSize];
-    int bytes_read{ 0 };
+void Server::ReceivePackets()
+{
+    // Reap the io_uring completions, each datagram is handled in its provided buffer
+    if (m_UseIoUring)
+    {
+        m_UringSocket.ReceivePackets(KG_BIND_CLASS_FN(HandlePacket));
+        return;
+    }
 
-    do 
+    if (m_ReceiveCoalescing)
     {
-        bytes_read = m_ServerSocket.Receive(sender, buffer, sizeof(buffer));
+        ReceiveCoalescedPackets();
+        return;
+    }
+
+    int numPackets{ 0 };
+    int numSlots{ 0 };
 
-        if (bytes_read >= (k_PacketHeaderSize))
+    do 
+    {
+        // Make sure the receive slots hold pooled buffers
+        for (numSlots = 0; numSlots < k_MaxPacketBatchSize; numSlots++)
         {
-            // Check for a valid app ID
-            if (*(AppID*)&buffer != m_Config.m_AppProtocolID)
+            PacketHandle& packet = m_ReceivePackets[numSlots];
+            if (!packet)
             {
-                TSLogger::Log("Failed to validate the app ID from packet\n");
-                continue;
+                packet = m_PacketPool.Acquire();
             }
+            if (!packet)
+            {
+                break;
+            }
+        }
 
-            // Get the packet type
-            PacketType type = (PacketType)buffer[sizeof(AppID)];
-
-            ClientIndex index = (ClientIndex)buffer[sizeof(AppID) + sizeof(PacketType)];
+        // Fall back to the fixed batch if the pool is exhausted (packets with reliable messages are dropped unacknowledged)
+        if (numSlots == 0)
+        {
+            numSlots = k_MaxPacketBatchSize;
+            numPackets = m_ServerSocket.ReceiveBatch(m_ReceiveBatch);
 
-            // Handle messages for already connected clients
-            if (m_AllConnections.IsConnectionActive(index))
+            for (int iteration{ 0 }; iteration < numPackets; iteration++)
             {
-                // Get the indicated connection
-                Connection* connection = m_AllConnections.GetConnection(index);
-                KG_ASSERT(connection);
+                HandlePacket(m_ReceiveBatch.m_Addresses[iteration], m_ReceiveBatch.m_Buffers[iteration],
+                    m_ReceiveBatch.m_Sizes[iteration]);
+            }
+            continue;
+        }
 
-                // Process packet reliability
-                connection->m_ReliabilityContext.ProcessReliabilitySegmentFromPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+        // Drain up to a full batch of datagrams directly into the pooled buffers
+        numPackets = m_ServerSocket.ReceiveBatch(m_ReceivePackets.data(), numSlots);
 
-                switch (type)
-                {
-                case PacketType::KeepAlive:
-                {
-                    Connection* clientConnection = m_AllConnections.GetConnection(index);
-                    if (!clientConnection)
-                    {
-                        TSLogger::Log("Failed to get connection object when receiving a keep alive packet\n");
-                        continue;
-                    }
-
-                    // Reset connection
-                    return;
-                }
-                case PacketType::ConnectionRequest:
-                    continue;
-                case PacketType::Message:
-                {
-                    bool valid = isValidCString((char*)buffer + k_PacketHeaderSize);
-                    if (!valid)
-                    {
-                        TSLogger::Log("Buffer could not be converted into a c-string\n");
-                        continue;
-                    }
-
-                    TSLogger::Log("[%i.%i.%i.%i:%i]: ", sender.GetA(), sender.GetB(),
-                        sender.GetC(), sender.GetD(), sender.GetPort());
-                    TSLogger::Log("%s", buffer + k_PacketHeaderSize);
-                    TSLogger::Log("\n");
-                    continue;
-                }
-                default:
-                    TSLogger::Log("Invalid packet ID obtained\n");
-                    continue;
-                }
-            }
-            else
+        for (int iteration{ 0 }; iteration < numPackets; iteration++)
+        {
+            PacketHandle& packet = m_ReceivePackets[iteration];
+            HandlePacket(packet.GetSender(), packet.GetBuffer(), packet.GetSize(), packet);
+
+            // Buffers the application kept are replaced, the rest are reused
+            if (packet.IsShared())
             {
-                // Handle new connections
-                if (type == PacketType::ConnectionRequest)
-                {
-                    ClientIndex connectionIndex = m_AllConnections.AddConnection(sender);
-
-                    // TODO: Handle rejection case better
-                    if (connectionIndex == k_InvalidClientIndex)
-                    {
-                        return;
-                    }
-
-                    if (!m_ManageConnections && m_AllConnections.GetNumberOfClients() > 0)
-                    {
-                        m_ManageConnections = true;
-                        m_ManageConnectionTimer.InitializeTimer();
-                        m_KeepAliveTimer.InitializeTimer();
-                    }
-
-                    // Get the connection reference
-                    Connection* newConnection = m_AllConnections.GetConnection(connectionIndex);
-
-                    if (newConnection)
-                    {
-                        TSLogger::Log("New connection created\n");
-                        SendToConnection(connectionIndex, PacketType::ConnectionSuccess, nullptr, 0);
-                    }
-                }
+                packet.Reset();
             }
         }
-    } while (bytes_read > 0);
+    } while (numPackets == numSlots);
+}
+
+void Server::ReceiveCoalescedPackets()
+{
+    int bytes_read{ 0 };
 
-    // Allow the thread to sleep if not managing connections
-    if (!m_ManageConnections)
+    while ((bytes_read = m_ServerSocket.ReceiveCoalesced(m_CoalescedPacket)) > 0)
     {
-        m_NetworkThread.SuspendThread(true);
+        // Split the coalesced buffer into its individual datagrams in place
+        int segmentSize = m_CoalescedPacket.m_SegmentSize;
+        for (int offset{ 0 }; offset < bytes_read; offset += segmentSize)
+        {
+            int packetSize = bytes_read - offset < segmentSize ? bytes_read - offset : segmentSize;
+            HandlePacket(m_CoalescedPacket.m_Sender, &m_CoalescedPacket.m_Buffer[offset], packetSize);
+        }
     }
-    
 }
 
-void Server::RunNetworkEventThread()
+void Server::HandlePacket(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket)
 {
-    DWORD waitResult = WaitForMultipleObjects(2, allEvents, FALSE, INFINITE);
+    if (size < (int)k_PacketHeaderSize)
+    {
+        return;
+    }
 
-    if (waitResult == WAIT_OBJECT_0)  // Network event
+    // Check for a valid app ID
+    if (*(AppID*)buffer != m_Config.m_AppProtocolID)
     {
-        WSANETWORKEVENTS netEvents;
-        WSAEnumNetworkEvents(m_ServerSocket.GetHandle(), hNetworkEvent, &netEvents);
+        TSLogger::Log("Failed to validate the app ID from packet\n");
+        return;
+    }
 
-        if (netEvents.lNetworkEvents & FD_READ)
+    // Compressed packets are expanded and handled again, their messages are copied into the pool
+    //      when delivered
+    if (buffer[sizeof(AppID)] & k_CompressedPacketFlag)
+    {
+        int decompressedSize = m_PacketCompressor.DecompressPacket(buffer, size, m_DecompressedPacket.data());
+        if (decompressedSize == 0)
         {
-            m_NetworkThread.ResumeThread();
+            TSLogger::Log("Failed to decompress packet\n");
+            return;
         }
+        HandlePacket(sender, m_DecompressedPacket.data(), decompressedSize);
+        return;
     }
-    else if (waitResult == WAIT_OBJECT_0 + 1)  // Console input event
+
+    // Get the packet type
+    PacketType type = (PacketType)buffer[sizeof(AppID)];
+
+    ClientIndex index = ReadClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)]);
+
+    // Handle messages for already connected clients
+    if (m_AllConnections.IsConnectionActive(index))
     {
-        INPUT_RECORD inputRecord;
-        DWORD eventsRead;
+        // Get the indicated connection
+        Connection* connection = m_AllConnections.GetConnection(index);
+        KG_ASSERT(connection);
 
-        while (true)
+        // Connection requests from connected clients carry no reliability segment
+        if (IsConnectionManagementPacket(type))
         {
-            DWORD numEvents;
-            if (!GetNumberOfConsoleInputEvents(hInputEvent, &numEvents) || numEvents == 0)
-                break;  // No more events, exit the loop
+            return;
+        }
 
-            if (ReadConsoleInput(hInputEvent, &inputRecord, 1, &eventsRead))
+        // Reserve the blocks the packet's messages need before it is acknowledged, packets that
+        //      can not be held are dropped unacknowledged so the client resends them
+        bool carriesMessages = type == PacketType::Message || type == PacketType::KeepAlive;
+        if (carriesMessages && !connection->ReserveReceiveBlocks(buffer, size, (bool)pooledPacket, m_PacketPool, m_ReassemblyPool))
+        {
+            TSLogger::Log("Receive pools exhausted, dropping packet\n");
+            return;
+        }
+
+        // Process packet reliability and refresh the connection's hot state
+        ReliabilityContext& reliabilityContext = connection->m_ReliabilityContext;
+        bool accepted = reliabilityContext.ProcessReliabilitySegmentFromPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+        m_AllConnections.SetConnectionCongested(index, reliabilityContext.m_CongestionContext.IsCongested());
+
+        // Drop duplicated and invalid packets
+        if (!accepted)
+        {
+            return;
+        }
+        m_AllConnections.OnPacketReceived(index);
+
+        // Confirm path probes and notify the application of reliable messages carried by newly
+        //      acknowledged packets
+        connection->m_PathMtuContext.OnPacketsAcknowledged(reliabilityContext.GetNewestSentSequence(),
+            reliabilityContext.GetNewlyAcknowledgedField());
+        connection->OnPacketsAcknowledged(reliabilityContext.GetNewestSentSequence(),
+            reliabilityContext.GetNewlyAcknowledgedField(), [&](ChannelType channel, uint16_t messageID)
             {
-                if (inputRecord.EventType == KEY_EVENT && inputRecord.Event.KeyEvent.bKeyDown)
+                if (m_DeliveryHandler)
                 {
-                    char key = inputRecord.Event.KeyEvent.uChar.AsciiChar;
-
-                    m_NetworkEventQueue.SubmitEvent(std::make_shared<KeyPressedEvent>(key));
-                    m_NetworkThread.ResumeThread();
+                    m_DeliveryHandler(index, channel, messageID);
                 }
-            }
+            });
+
+        // Acks make room for more fragments, send them with the next outbox flush
+        if (reliabilityContext.GetNewlyAcknowledgedField() != 0 && connection->IsSendingFragments() &&
+            connection->HasMessagesToSend(reliabilityContext.GetResendDelay()))
+        {
+            m_AllConnections.SetConnectionOutboxPending(index, true);
+        }
+
+        switch (type)
+        {
+        case PacketType::KeepAlive:
+        case PacketType::Message:
+        {
+            ReceiveMessages(index, *connection, sender, buffer, size, pooledPacket);
+            return;
+        }
+        case PacketType::PathProbe:
+            // Only the acknowledgement of the probe matters
+            return;
+        default:
+            TSLogger::Log("Invalid packet ID obtained\n");
+            return;
+        }
+    }
+
+    // Handle new connections
+    if (type == PacketType::ConnectionRequest)
+    {
+        // Deny clients using a different wire format
+        if (size < (int)(k_PacketHeaderSize + k_ConnectionRequestSize) || buffer[k_PacketHeaderSize] != k_ProtocolVersion)
+        {
+            TSLogger::Log("Denied a connection request with a mismatched protocol version\n");
+            SendConnectionDenied(sender);
+            return;
+        }
+
+        // Both ends must track the same reliable window
+        if (ReadUInt16(&buffer[k_PacketHeaderSize + sizeof(uint8_t)]) != m_Config.m_ReliableWindowSize)
+        {
+            TSLogger::Log("Denied a connection request with a mismatched reliable window size\n");
+            SendConnectionDenied(sender);
+            return;
+        }
+
+        // Either end may send compressed packets, so both must use the same dictionary
+        if (ReadUInt32(&buffer[k_PacketHeaderSize + sizeof(uint8_t) + 2 * sizeof(uint16_t)]) != m_PacketCompressor.GetDictionaryID())
+        {
+            TSLogger::Log("Denied a connection request with a mismatched compression dictionary\n");
+            SendConnectionDenied(sender);
+            return;
+        }
+
+        // A retried request from a connected address (the success packet was lost) is answered again
+        ClientIndex existingIndex = m_AllConnections.FindConnection(sender);
+        if (existingIndex != k_InvalidClientIndex)
+        {
+            SendConnectionSuccess(existingIndex);
+            return;
+        }
+
+        ClientIndex connectionIndex = m_AllConnections.AddConnection(sender);
+
+        // TODO: Handle rejection case better
+        if (connectionIndex == k_InvalidClientIndex)
+        {
+            return;
+        }
+
+        if (!m_ManageConnections && m_AllConnections.GetNumberOfClients() > 0)
+        {
+            SetManageConnections(true);
+        }
+
+        // Get the connection reference
+        Connection* newConnection = m_AllConnections.GetConnection(connectionIndex);
+
+        if (newConnection)
+        {
+            // Both ends use the smaller maximum packet size and probe the path up to it
+            uint16_t requestedPacketSize = ReadUInt16(&buffer[k_PacketHeaderSize + sizeof(uint8_t) + sizeof(uint16_t)]);
+            uint16_t maxPacketSize = std::clamp(requestedPacketSize, (uint16_t)k_MinPacketSize, m_Config.m_MaxPacketSize);
+            newConnection->m_PathMtuContext.Init(maxPacketSize);
+            m_AllConnections.SetConnectionProbing(connectionIndex, newConnection->m_PathMtuContext.IsSearching());
+
+            TSLogger::Log("New connection created\n");
+            SendConnectionSuccess(connectionIndex);
         }
     }
 }
 
+void Server::SubmitConsoleInput()
+{
+    char keys[64];
+    int numKeys = m_Reactor.ReadConsoleKeys(keys, sizeof(keys));
+
+    for (int iteration{ 0 }; iteration < numKeys; iteration++)
+    {
+        KeyPressedEvent keyEvent{ keys[iteration] };
+        if (m_ConsoleEventHandler)
+        {
+            m_ConsoleEventHandler(keyEvent);
+            continue;
+        }
+
+        if (!m_NetworkEventQueue.SubmitEvent(keyEvent))
+        {
+            TSLogger::Log("Event queue full, dropping console input\n");
+        }
+    }
+}
+
+void Server::SetManageConnections(bool manageConnections)
+{
+    m_ManageConnections = manageConnections;
+
+    // Only run the reactor's timer while there are connections to manage
+    if (manageConnections)
+    {
+        m_ManageConnectionTimer.InitializeTimer();
+        m_Reactor.StartTimer(m_ManageConnectionTimer.GetConstantFrameTime());
+    }
+    else
+    {
+        m_Reactor.StopTimer();
+    }
+}
+
 bool Server::ManageConnections()
 {
     if (!m_ManageConnectionTimer.CheckForUpdate())
@@ -250,54 +441,80 @@ bool Server::ManageConnections()
         return false;
     }
 
-    if (m_KeepAliveTimer.CheckForUpdate(m_ManageConnectionTimer.GetConstantFrameTime()))
+    // Flush the messages queued during this tick first, so connections sent data do not also
+    //      need a keep-alive
+    FlushConnectionOutboxes();
+
+    // Advance the connection timers, only connections with a deadline on this tick are visited
+    std::vector<ClientIndex>& clientsToRemove = m_TimedOutConnections;
+    clientsToRemove.clear();
+    m_SweepConnections.clear();
+    m_AllConnections.AdvanceTick(clientsToRemove, m_SweepConnections);
+
+    // Send keep-alives to connections that have not been sent a packet for a keep-alive interval,
+    //      followed by a few packets for resends that are due
+    for (ClientIndex currentIndex : m_SweepConnections)
     {
-        static uint32_t s_CongestionCounter{ 0 };
+        Connection& connection = *m_AllConnections.GetConnection(currentIndex);
+        QueueToConnection(currentIndex, connection, PacketType::KeepAlive, nullptr, 0);
 
-        if (s_CongestionCounter % 3 == 0)
+        float resendDelay = connection.m_ReliabilityContext.GetResendDelay();
+        for (int packetCount{ 1 }; packetCount < k_MaxResendPacketsPerTick && connection.HasMessagesToSend(resendDelay); packetCount++)
         {
-            // Send keep-alive to all connections
-            SendToAllConnections(PacketType::KeepAlive, nullptr, 0);
+            QueueToConnection(currentIndex, connection, PacketType::Message, nullptr, 0);
         }
-        else
-        {
-            // Only send keep alive to non-congested connections
-            ClientIndex index{ 0 };
-            for (Connection& connection : m_AllConnections.GetAllConnections())
-            {
-                if (!m_AllConnections.IsConnectionActive(index))
-                {
-                    continue;
-                }
+    }
 
-                if (!connection.m_ReliabilityContext.m_CongestionContext.IsCongested())
-                {
-                    SendToConnection(index, PacketType::KeepAlive, nullptr, 0);
-                }
-                index++;
-            }
-        }
+    // Submit all keep-alive packets together
+    if (!m_SweepConnections.empty())
+    {
+        FlushSendBatch();
+    }
+
+    // Send the packets queued for each connection during this tick
+    FlushAllConnectionQueues();
+
+    float deltaTime = m_ManageConnectionTimer.GetConstantFrameTimeFloat();
 
-        s_CongestionCounter++;
+    // Only congested connections need their congestion state aged (a connection that becomes
+    //      congested restarts its recovery time anyway)
+    m_SweepConnections.clear();
+    m_AllConnections.GetConnectionsWithFlags(ConnectionCongested, 0, m_SweepConnections);
+    for (ClientIndex currentIndex : m_SweepConnections)
+    {
+        ReliabilityContext& reliabilityContext = m_AllConnections.GetConnection(currentIndex)->m_ReliabilityContext;
+        reliabilityContext.m_CongestionContext.OnUpdate(deltaTime, reliabilityContext.m_RoundTripContext.GetAverageRoundTrip());
+        m_AllConnections.SetConnectionCongested(currentIndex, reliabilityContext.m_CongestionContext.IsCongested());
     }
 
-    // Add delta-time to last-packet-received time for all connections
-    std::vector<ClientIndex> clientsToRemove;
-    ClientIndex index{ 0 };
-    for (Connection& connection : m_AllConnections.GetAllConnections())
+    // Send the path probes that are due, connections stop probing once their search is done
+    m_SweepConnections.clear();
+    m_AllConnections.GetConnectionsWithFlags(ConnectionProbing, 0, m_SweepConnections);
+    for (ClientIndex currentIndex : m_SweepConnections)
     {
-        if (!m_AllConnections.IsConnectionActive(index))
+        Connection* connection = m_AllConnections.GetConnection(currentIndex);
+        PathMtuContext& pathMtuContext = connection->m_PathMtuContext;
+        uint16_t probeSize = pathMtuContext.GetProbeSize(connection->m_ReliabilityContext.m_RoundTripContext.GetAverageRoundTrip());
+        if (probeSize != 0)
         {
-            continue;
+            SendPathProbe(currentIndex, *connection, probeSize);
         }
+        m_AllConnections.SetConnectionProbing(currentIndex, pathMtuContext.IsSearching());
+    }
 
-        connection.m_ReliabilityContext.OnUpdate(m_ManageConnectionTimer.GetConstantFrameTimeFloat());
-
-        if (connection.m_ReliabilityContext.m_LastPacketReceived > m_Config.m_ConnectionTimeout)
+    // Remove connections whose client stopped sending fragments, the fragments received so far
+    //      were acknowledged so the message can not be dropped
+    m_SweepConnections.clear();
+    m_AllConnections.GetConnectionsWithFlags(ConnectionReassembling, 0, m_SweepConnections);
+    for (ClientIndex currentIndex : m_SweepConnections)
+    {
+        Connection* connection = m_AllConnections.GetConnection(currentIndex);
+        if (connection->IsReassemblyStalled(m_Config.m_ReassemblyTimeout) &&
+            std::find(clientsToRemove.begin(), clientsToRemove.end(), currentIndex) == clientsToRemove.end())
         {
-            clientsToRemove.push_back(index);
+            TSLogger::Log("Reassembly timed out\n");
+            clientsToRemove.push_back(currentIndex);
         }
-        index++;
     }
 
     // Remove timed-out connections
@@ -309,7 +526,7 @@ bool Server::ManageConnections()
 
     if (m_AllConnections.GetNumberOfClients() <= 0)
     {
-        m_ManageConnections = false;
+        SetManageConnections(false);
     }
 
     return true;
@@ -317,16 +534,25 @@ bool Server::ManageConnections()
 
 void Server::HandleConsoleInput(KeyPressedEvent event)
 {
+    // Every shard tracks the console text, only the first shard echoes it
+    bool echoInput = m_ShardIndex == 0;
+
     char key = event.GetKeyCode();
     if (key >= 32 && key < 127)
     {
-        text += key;
-        TSLogger::Log("%c", key);
+        m_ConsoleText += key;
+        if (echoInput)
+        {
+            TSLogger::Log("%c", key);
+        }
     }
-    if (key == 127 && text.size() > 0)
+    if (key == 127 && m_ConsoleText.size() > 0)
     {
-        TSLogger::Log("\b \b");
-        text.pop_back();
+        if (echoInput)
+        {
+            TSLogger::Log("\b \b");
+        }
+        m_ConsoleText.pop_back();
     }
     if (key == 27) // Escape key
     {
@@ -335,27 +561,152 @@ void Server::HandleConsoleInput(KeyPressedEvent event)
     }
     if (key == 13)
     {
-        SendToAllConnections(PacketType::Message, text.data(), (int)strlen(text.data()) + 1);
-        text.clear();
+        SendToAllConnections(PacketType::Message, m_ConsoleText.data(), (int)strlen(m_ConsoleText.data()) + 1);
+        m_ConsoleText.clear();
     }
     
     return;
 }
 
-void Server::OnEvent(Event* event)
+void Server::OnEvent(const AppUpdateEvent&)
+{
+    // Connection management is driven by the reactor timer
+}
+
+void Server::OnEvent(const KeyPressedEvent& event)
+{
+    HandleConsoleInput(event);
+}
+
+bool Server::SubmitEvent(const EventVariant& event)
+{
+    if (!m_NetworkEventQueue.SubmitEvent(event))
+    {
+        return false;
+    }
+
+    m_Reactor.Wake();
+    return true;
+}
+
+void Server::SetConsoleEventHandler(std::function<void(const EventVariant&)> handler)
 {
-    if (event->GetEventType() == EventType::KeyPressed)
+    m_ConsoleEventHandler = handler;
+}
+
+void Server::ReceiveMessages(ClientIndex clientIndex, Connection& connection, const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket)
+{
+    MessageRecord record;
+    int offset{ (int)k_PacketHeaderSize };
+
+    while (offset < size)
     {
-        HandleConsoleInput(*(KeyPressedEvent*)event);
+        int recordSize = ReadMessageRecord(&buffer[offset], size - offset, record);
+        if (recordSize == 0)
+        {
+            TSLogger::Log("Received a malformed message record\n");
+            return;
+        }
+        offset += recordSize;
+
+        connection.ReceiveMessage(record, pooledPacket, [&](const uint8_t* message, int messageSize, const PacketHandle& pooledMessage)
+            {
+                DeliverMessage(clientIndex, sender, buffer, size, pooledPacket, message, messageSize, pooledMessage);
+            });
     }
+
+    connection.ReleaseReservedBlocks();
+
+    // Incomplete reassemblies are checked for their timeout on each connection management tick
+    m_AllConnections.SetConnectionReassembling(clientIndex, connection.IsReassembling());
 }
 
+void Server::DeliverMessage(ClientIndex clientIndex, const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket,
+    const uint8_t* message, int messageSize, const PacketHandle& pooledMessage)
+{
+    // Without a handler the message is logged as text
+    if (!m_MessageHandler)
+    {
+        const char* text = (const char*)message;
+        if (messageSize <= 0 || text[messageSize - 1] != '\0' || !isValidCString(text))
+        {
+            TSLogger::Log("Buffer could not be converted into a c-string\n");
+            return;
+        }
 
-void Server::SubmitEvent(Ref<Event> event)
+        TSLogger::Log("[%i.%i.%i.%i:%i]: ", sender.GetA(), sender.GetB(),
+            sender.GetC(), sender.GetD(), sender.GetPort());
+        TSLogger::Log("%s", text);
+        TSLogger::Log("\n");
+        return;
+    }
+
+    // Reliable messages are already held in a pooled block (reserved before their packet was
+    //      acknowledged)
+    if (pooledMessage)
+    {
+        m_MessageHandler(clientIndex, pooledMessage);
+        return;
+    }
+
+    // Hand over a view of the message in the pooled buffer the packet was received in
+    if (pooledPacket && message >= buffer && message + messageSize <= buffer + size)
+    {
+        PacketHandle messagePacket{ pooledPacket };
+        messagePacket.SetPayload((int)(message - buffer), messageSize);
+        m_MessageHandler(clientIndex, messagePacket);
+        return;
+    }
+
+    // Unreliable messages and snapshots received outside the pool (io_uring, coalesced, pool
+    //      exhausted, or decoded) are copied into it, and dropped if it is exhausted
+    PacketHandle messagePacket = m_PacketPool.Acquire();
+    if (!messagePacket)
+    {
+        TSLogger::Log("Packet pool exhausted, dropping message\n");
+        return;
+    }
+
+    memcpy(messagePacket.GetBuffer() + k_PacketHeaderSize, message, messageSize);
+    messagePacket.SetContents(sender, (int)k_PacketHeaderSize + messageSize);
+    m_MessageHandler(clientIndex, messagePacket);
+}
+
+void Server::SetMessageHandler(ServerMessageFn handler)
+{
+    m_MessageHandler = handler;
+}
+
+void Server::SetDeliveryHandler(ServerDeliveryFn handler)
 {
-    m_NetworkEventQueue.SubmitEvent(event);
+    m_DeliveryHandler = handler;
+}
+
+bool Server::AttachShardSteeringProgram()
+{
+#if PLATFORM == PLATFORM_UNIX
+    KG_ASSERT(m_Config.m_MaxClients >= m_Config.m_NumServerShards);
 
-    m_NetworkEventThread.ResumeThread();
+    // The program runs on the UDP payload and returns the index of the shard's socket
+    sock_filter instructions[]
+    {
+        // Connection requests return an out of range index, which falls back to the kernel's hash
+        //      of the source address, so every retry from a client reaches the same shard
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, sizeof(AppID)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)PacketType::ConnectionRequest, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+        // Route everything else to the shard owning the client index (out of range indices
+        //      also fall back to the kernel's hash)
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, sizeof(AppID) + sizeof(PacketType)),
+        BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, (uint32_t)(m_Config.m_MaxClients / m_Config.m_NumServerShards)),
+        BPF_STMT(BPF_RET | BPF_A, 0)
+    };
+
+    return m_ServerSocket.AttachReusePortFilter(instructions, sizeof(instructions) / sizeof(sock_filter));
+#else
+    TSLogger::Log("Shard steering programs are not supported on this platform\n");
+    return false;
+#endif
 }
 
 bool Server::SendToConnection(ClientIndex clientIndex, PacketType type, const void* payload, int payloadSize)
@@ -369,42 +720,54 @@ bool Server::SendToConnection(ClientIndex clientIndex, PacketType type, const vo
         return false;
     }
 
-    if (payloadSize >= k_MaxPayloadSize)
+    if (payloadSize > (int)k_MaxMessageSize)
     {
         TSLogger::Log("Failed to send packet. Payload exceeds maximum size limit\n");
         return false;
     }
 
-    // Prepare the final data buffer
-    uint8_t buffer[k_MaxPacketSize];
+    // Make space in the connection's outgoing queue if necessary
+    uint8_t* packetLocation = connection->m_OutgoingQueue.GetNextPacketLocation();
+    if (!packetLocation)
+    {
+        FlushConnectionQueue(*connection);
+        packetLocation = connection->m_OutgoingQueue.GetNextPacketLocation();
+    }
 
-    // Set the app ID
-    AppID& appIDLocation = *(AppID*)&buffer[0];
-    appIDLocation = m_Config.m_AppProtocolID;
+    // Write the packet into the queue, it is sent on the next connection management tick
+    int packetSize = WritePacket(packetLocation, clientIndex, *connection, type, payload, payloadSize);
+    connection->m_OutgoingQueue.CommitPacket(packetSize);
+    m_AllConnections.SetConnectionQueuePending(clientIndex, true);
 
-    // Set the packet type
-    PacketType& packetTypeLocation = *(PacketType*)&buffer[sizeof(AppID)];
-    packetTypeLocation = type;
+    return true;
+}
 
-    // Send the client connection Index
-    ClientIndex& clientIndexLocation = *(ClientIndex*)&buffer[sizeof(AppID) + sizeof(PacketType)];
-    clientIndexLocation = clientIndex;
+bool Server::SendMessageToConnection(ClientIndex clientIndex, ChannelType channel, const void* payload, int payloadSize, uint16_t* messageID)
+{
+    // Get the connection
+    Connection* connection = m_AllConnections.GetConnection(clientIndex);
 
-    if (!IsConnectionManagementPacket(type))
+    if (!connection)
     {
-        // Insert the sequence number + ack + ack_bitfield
-        connection->m_ReliabilityContext.InsertReliabilitySegmentIntoPacket(&buffer[sizeof(AppID) + sizeof(PacketType)]);
+        TSLogger::Log("Failed to send message to connection. Invalid connection context provided\n");
+        return false;
     }
 
-    // Optionally insert the payload
-    if (payloadSize > 0)
+    uint16_t queuedMessageID;
+    if (!connection->QueueMessage(channel, payload, payloadSize, queuedMessageID))
+    {
+        TSLogger::Log("Failed to send message. Payload exceeds maximum size limit or the channel is full\n");
+        return false;
+    }
+
+    if (messageID)
     {
-        // Set the data
-        memcpy(&buffer[k_PacketHeaderSize], payload, payloadSize);
+        *messageID = queuedMessageID;
     }
 
-    m_ServerSocket.Send(connection->m_Address, buffer, 
-        payloadSize + k_PacketHeaderSize);
+    // The message waits in the connection's outbox and is coalesced with the other messages
+    //      queued during this tick on the next connection management tick
+    m_AllConnections.SetConnectionOutboxPending(clientIndex, true);
 
     return true;
 }
@@ -412,49 +775,264 @@ bool Server::SendToConnection(ClientIndex clientIndex, PacketType type, const vo
 bool Server::SendToAllConnections(PacketType type, const void* payload, int payloadSize)
 {
     // Check the payload size is valid
-    if (payloadSize >= k_MaxPayloadSize)
+    if (payloadSize > (int)k_MaxMessageSize)
     {
         TSLogger::Log("Failed to send packet. Payload exceeds maximum size limit\n");
         return false;
     }
 
+    // Submit any pending datagrams that do not share this payload
+    FlushSendBatch();
+
     // Loop through all of the connections
-    ClientIndex currentIndex{ 0 };
+    ClientIndex index{ m_AllConnections.GetFirstClientIndex() };
     for (Connection& connection : m_AllConnections.GetAllConnections())
     {
+        ClientIndex currentIndex{ index++ };
         if (!m_AllConnections.IsConnectionActive(currentIndex))
         {
-            currentIndex++;
             continue;
         }
 
-        // Prepare the final data buffer
-        uint8_t buffer[k_MaxPacketSize];
+        if (m_SendBatchCount >= k_MaxPacketBatchSize)
+        {
+            FlushSendBatch(payload, payloadSize);
+        }
 
-        // Set the app ID
-        AppID& appIDLocation = *(AppID*)&buffer[0];
-        appIDLocation = m_Config.m_AppProtocolID;
+        // Only the per-connection header is written into the batch, the payload is shared
+        m_SendBatch.m_Addresses[m_SendBatchCount] = connection.m_Address;
+        m_SendBatch.m_Sizes[m_SendBatchCount] = WritePacket(m_SendBatch.m_Buffers[m_SendBatchCount],
+            currentIndex, connection, type, nullptr, payloadSize);
+        m_SendBatchCount++;
+    }
 
-        // Set the packet type
-        PacketType& packetTypeLocation = *(PacketType*)&buffer[sizeof(AppID)];
-        packetTypeLocation = type;
+    // Submit the broadcast with as few send calls as possible
+    FlushSendBatch(payload, payloadSize);
 
-        if (!IsConnectionManagementPacket(type))
+    return true;
+}
+
+int Server::WritePacket(uint8_t* buffer, ClientIndex clientIndex, Connection& connection, PacketType type, const void* payload, int payloadSize)
+{
+    // Set the app ID
+    AppID& appIDLocation = *(AppID*)&buffer[0];
+    appIDLocation = m_Config.m_AppProtocolID;
+
+    // Set the packet type
+    PacketType& packetTypeLocation = *(PacketType*)&buffer[sizeof(AppID)];
+    packetTypeLocation = type;
+
+    // Send the client connection Index
+    WriteClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)], clientIndex);
+
+    // Management packets carry their payload directly after the header
+    if (IsConnectionManagementPacket(type))
+    {
+        if (payload && payloadSize > 0)
         {
-            // Insert the sequence number + ack + ack_bitfield
-            connection.m_ReliabilityContext.InsertReliabilitySegmentIntoPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+            memcpy(&buffer[k_PacketHeaderSize], payload, payloadSize);
         }
+        return (payload ? payloadSize : 0) + (int)k_PacketHeaderSize;
+    }
 
-        if (payloadSize > 0)
+    // Insert the sequence number + ack + ack_bitfield
+    ReliabilityContext& reliabilityContext = connection.m_ReliabilityContext;
+    reliabilityContext.InsertReliabilitySegmentIntoPacket(&buffer[sizeof(AppID) + sizeof(PacketType) + sizeof(ClientIndex)]);
+
+    // Detecting a dropped packet may change the congestion state
+    m_AllConnections.SetConnectionCongested(clientIndex, reliabilityContext.m_CongestionContext.IsCongested());
+
+    // Probes carry no messages, they are padded to the probed size (passed as the payload size)
+    if (type == PacketType::PathProbe)
+    {
+        memset(&buffer[k_PacketHeaderSize], 0, payloadSize - k_PacketHeaderSize);
+        return payloadSize;
+    }
+
+    // Any sequenced packet keeps the connection alive
+    m_AllConnections.OnPacketSent(clientIndex);
+
+    // Pack the queued messages of every channel, leaving room for the payload
+    int packetSize{ (int)k_PacketHeaderSize };
+    int payloadRecordSize = payloadSize > 0 ? (int)k_MessageRecordHeaderSize + payloadSize : 0;
+    packetSize += connection.WriteMessages(reliabilityContext.GetNewestSentSequence(), &buffer[packetSize],
+        (int)connection.m_PathMtuContext.GetPacketSize() - packetSize - payloadRecordSize, m_Config.m_ChannelBudgets, reliabilityContext.GetResendDelay());
+
+    // Wrap the payload in an unreliable message record
+    if (payloadSize > 0)
+    {
+        int recordSize = WriteMessageRecord(&buffer[packetSize], ChannelType::Unreliable, 0, payload, payloadSize);
+        packetSize += payload ? recordSize : recordSize - payloadSize;
+    }
+
+    // A payload appended by the caller (shared by a broadcast) cannot be compressed with the packet
+    if (m_Config.m_CompressPackets && (payload || payloadSize == 0))
+    {
+        packetSize = m_PacketCompressor.CompressPacket(buffer, packetSize);
+    }
+
+    return packetSize;
+}
+
+void Server::SendConnectionSuccess(ClientIndex clientIndex)
+{
+    Connection* connection = m_AllConnections.GetConnection(clientIndex);
+    KG_ASSERT(connection);
+
+    // Tell the client the negotiated maximum packet size
+    uint8_t payload[k_ConnectionSuccessSize];
+    WriteUInt16(payload, connection->m_PathMtuContext.GetMaxPacketSize());
+    SendToConnection(clientIndex, PacketType::ConnectionSuccess, payload, sizeof(payload));
+}
+
+void Server::SendPathProbe(ClientIndex clientIndex, Connection& connection, uint16_t probeSize)
+{
+    // Sent on its own, so a probe that is too large for the path cannot fail a batch of regular packets
+    uint8_t buffer[k_MaxPacketSize];
+    int packetSize = WritePacket(buffer, clientIndex, connection, PacketType::PathProbe, nullptr, probeSize);
+    connection.m_PathMtuContext.OnProbeSent(probeSize, connection.m_ReliabilityContext.GetNewestSentSequence());
+    m_ServerSocket.Send(connection.m_Address, buffer, packetSize);
+}
+
+void Server::SendConnectionDenied(const Address& destination)
+{
+    uint8_t buffer[k_PacketHeaderSize]{};
+
+    // Management packets only carry the app ID, packet type, and client index
+    buffer[0] = m_Config.m_AppProtocolID;
+    buffer[sizeof(AppID)] = (uint8_t)PacketType::ConnectionDenied;
+    WriteClientIndex(&buffer[sizeof(AppID) + sizeof(PacketType)], k_InvalidClientIndex);
+
+    m_ServerSocket.Send(destination, buffer, sizeof(buffer));
+}
+
+void Server::FlushConnectionOutboxes()
+{
+    m_SweepConnections.clear();
+    m_AllConnections.GetConnectionsWithFlags(ConnectionOutboxPending, 0, m_SweepConnections);
+    if (m_SweepConnections.empty())
+    {
+        return;
+    }
+
+    // Pack each outbox into as few packets as possible, fragmented messages are written into as
+    //      many packets as they need. The packets go through the connection's outgoing queue, so
+    //      runs of full sized packets are sent as a single segmented send.
+    for (ClientIndex currentIndex : m_SweepConnections)
+    {
+        Connection& connection = *m_AllConnections.GetConnection(currentIndex);
+        float resendDelay = connection.m_ReliabilityContext.GetResendDelay();
+        do
         {
-            // Set the data
-            memcpy(&buffer[k_PacketHeaderSize], payload, payloadSize);
+            SendToConnection(currentIndex, PacketType::Message, nullptr, 0);
+        } while (connection.HasMessagesToSend(resendDelay));
+        m_AllConnections.SetConnectionOutboxPending(currentIndex, false);
+
+        FlushConnectionQueue(connection);
+        m_AllConnections.SetConnectionQueuePending(currentIndex, false);
+    }
+}
+
+void Server::QueueToConnection(ClientIndex clientIndex, Connection& connection, PacketType type, const void* payload, int payloadSize)
+{
+    // Submit the current batch if it is full
+    if (m_SendBatchCount >= k_MaxPacketBatchSize)
+    {
+        FlushSendBatch();
+    }
+
+    // Write the packet directly into the next batch slot
+    m_SendBatch.m_Addresses[m_SendBatchCount] = connection.m_Address;
+    m_SendBatch.m_Sizes[m_SendBatchCount] = WritePacket(m_SendBatch.m_Buffers[m_SendBatchCount],
+        clientIndex, connection, type, payload, payloadSize);
+    m_SendBatchCount++;
+}
+
+void Server::FlushSendBatch(const void* sharedPayload, int sharedPayloadSize)
+{
+    if (m_SendBatchCount == 0)
+    {
+        return;
+    }
+
+    if (m_UseIoUring)
+    {
+        // Queue one sendmsg entry per datagram and submit them together
+        for (int iteration{ 0 }; iteration < m_SendBatchCount; iteration++)
+        {
+            m_UringSocket.QueueSend(m_SendBatch.m_Addresses[iteration], m_SendBatch.m_Buffers[iteration],
+                m_SendBatch.m_Sizes[iteration], sharedPayload, sharedPayloadSize);
+        }
+        m_UringSocket.SubmitSends();
+    }
+    else
+    {
+        m_ServerSocket.SendBatch(m_SendBatch, m_SendBatchCount, sharedPayload, sharedPayloadSize);
+    }
+    m_SendBatchCount = 0;
+}
+
+void Server::FlushConnectionQueue(Connection& connection)
+{
+    OutgoingPacketQueue& queue = connection.m_OutgoingQueue;
+
+    int packetIndex{ 0 };
+    while (packetIndex < queue.GetPacketCount())
+    {
+        // Extend the run with equal sized packets (a single shorter packet may end the run)
+        int segmentSize = queue.GetPacketSize(packetIndex);
+        int totalSize = segmentSize;
+        int runEnd = packetIndex + 1;
+        while (runEnd < queue.GetPacketCount())
+        {
+            int nextSize = queue.GetPacketSize(runEnd);
+            if (nextSize > segmentSize)
+            {
+                break;
+            }
+
+            totalSize += nextSize;
+            runEnd++;
+
+            if (nextSize < segmentSize)
+            {
+                break;
+            }
         }
 
-        m_ServerSocket.Send(connection.m_Address, buffer, k_PacketHeaderSize + payloadSize);
+        if (m_UseIoUring)
+        {
+            // Queue the run's datagrams, they are submitted below
+            for (int iteration{ packetIndex }; iteration < runEnd; iteration++)
+            {
+                m_UringSocket.QueueSend(connection.m_Address, queue.GetPacketData(iteration),
+                    queue.GetPacketSize(iteration), nullptr, 0);
+            }
+        }
+        else
+        {
+            // Send the whole run at once, the kernel splits it into individual datagrams
+            m_ServerSocket.SendSegmented(connection.m_Address, queue.GetPacketData(packetIndex), segmentSize, totalSize);
+        }
+        packetIndex = runEnd;
+    }
 
-        currentIndex++;
+    queue.ClearQueue();
+
+    if (m_UseIoUring)
+    {
+        m_UringSocket.SubmitSends();
     }
+}
 
-    return true;
+void Server::FlushAllConnectionQueues()
+{
+    // Only connections with queued packets are visited
+    m_SweepConnections.clear();
+    m_AllConnections.GetConnectionsWithFlags(ConnectionQueuePending, 0, m_SweepConnections);
+    for (ClientIndex currentIndex : m_SweepConnections)
+    {
+        FlushConnectionQueue(*m_AllConnections.GetConnection(currentIndex));
+        m_AllConnections.SetConnectionQueuePending(currentIndex, false);
+    }
 }
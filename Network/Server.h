@@ -2,12 +2,23 @@
 
 #include "../Util/Thread.h"
 #include "../Posix/Socket.h"
+#include "../Posix/NetworkReactor.h"
+#include "../Posix/UringSocket.h"
 #include "../Util/LoopTimer.h"
-#include "../Util/PassiveLoopTimer.h"
 #include "../Posix/Connection.h"
+#include "../Posix/PacketCompressor.h"
 #include "../Util/EventQueue.h"
 #include "NetworkConfig.h"
 
+#include <array>
+#include <functional>
+
+// Called on the network thread with each received message. Copy the handle to keep the buffer.
+using ServerMessageFn = std::function<void(ClientIndex, const PacketHandle&)>;
+// Called on the network thread once a reliable message is acknowledged by the client (message IDs
+//		are per channel)
+using ServerDeliveryFn = std::function<void(ClientIndex, ChannelType, uint16_t messageID)>;
+
 class Server 
 {
 public:
@@ -20,7 +31,7 @@ public:
 	//==============================
 	// Lifecycle Functions
 	//==============================
-	bool InitServer(const NetworkConfig& initConfig);
+	bool InitServer(const NetworkConfig& initConfig, uint8_t shardIndex = 0);
 	bool TerminateServer(bool withinNetworkThread = false);
 
 	// Allows other threads to wait on the server to close
@@ -31,40 +42,108 @@ public:
 	//==============================
 	// Run socket/packet handling thread
 	void RunNetworkThread();
-	void RunNetworkEventThread();
 
 private:
 	// Helper functions
 	bool ManageConnections();
+	void SetManageConnections(bool manageConnections);
 	void HandleConsoleInput(KeyPressedEvent event);
+	void SubmitConsoleInput();
+	void ReceivePackets();
+	void ReceiveCoalescedPackets();
+	// The pooled packet is valid when the buffer was received directly into the packet pool
+	void HandlePacket(const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket = {});
+	// Deliver each message record of a sequenced packet
+	void ReceiveMessages(ClientIndex clientIndex, Connection& connection, const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket);
+	void DeliverMessage(ClientIndex clientIndex, const Address& sender, uint8_t* buffer, int size, const PacketHandle& pooledPacket,
+		const uint8_t* message, int messageSize, const PacketHandle& pooledMessage);
 
 public:
 	//==============================
 	// On Event
 	//==============================
-	void OnEvent(Event* event);
+	// Visited with the concrete type of each queued event
+	void OnEvent(const AppUpdateEvent& event);
+	void OnEvent(const KeyPressedEvent& event);
 
 	//==============================
 	// Manage Events
 	//==============================
-	void SubmitEvent(Ref<Event> event);
+	// Returns false if the event queue is bounded and full
+	bool SubmitEvent(const EventVariant& event);
+	// Redirect key presses read from the console (used to share console input between shards)
+	void SetConsoleEventHandler(std::function<void(const EventVariant&)> handler);
+	// Hand received messages to the application (set before InitServer). Messages are logged if unset.
+	void SetMessageHandler(ServerMessageFn handler);
+	// Notify the application when reliable messages are acknowledged (set before InitServer)
+	void SetDeliveryHandler(ServerDeliveryFn handler);
+
+	//==============================
+	// Manage Shards
+	//==============================
+	// Steer datagrams to the shard owning their client index, and connection requests by a hash
+	//		of their source address (only valid while running as a shard on Linux)
+	bool AttachShardSteeringProgram();
 
 	//==============================
 	// Send Packets
 	//==============================
 	bool SendToConnection(ClientIndex clientIndex, PacketType type, const void* data, int size);
+	// Queue a message on a channel, the messages queued during a tick are packed together on the
+	//		next connection management tick. Reliable channels resend it until acknowledged and report
+	//		the optional message ID to the delivery handler.
+	//		Messages on the Snapshot channel are replicated state, only the newest one is sent.
+	bool SendMessageToConnection(ClientIndex clientIndex, ChannelType channel, const void* data, int size, uint16_t* messageID = nullptr);
 	bool SendToAllConnections(PacketType type, const void* data, int size);
+private:
+	// Batched send helpers. A null payload with a size only writes the payload's record header,
+	//		the caller appends the payload.
+	int WritePacket(uint8_t* buffer, ClientIndex clientIndex, Connection& connection, PacketType type, const void* payload, int payloadSize);
+	// Send the messages queued on each connection since the last tick (as few packets as possible)
+	void FlushConnectionOutboxes();
+	// Reply to an accepted connection request with the negotiated maximum packet size
+	void SendConnectionSuccess(ClientIndex clientIndex);
+	// Reply to a connection request that was not accepted (sent immediately, no connection needed)
+	void SendConnectionDenied(const Address& destination);
+	// Send a padded probe of the provided datagram size immediately
+	void SendPathProbe(ClientIndex clientIndex, Connection& connection, uint16_t probeSize);
+	void QueueToConnection(ClientIndex clientIndex, Connection& connection, PacketType type, const void* payload, int payloadSize);
+	void FlushSendBatch(const void* sharedPayload = nullptr, int sharedPayloadSize = 0);
+	// Per-connection outgoing queue helpers
+	void FlushConnectionQueue(Connection& connection);
+	void FlushAllConnectionQueues();
 private:
 	//==============================
 	// Internal Data
 	//==============================
 	bool m_ManageConnections{ false };
+	uint8_t m_ShardIndex{ 0 };
+	// Scratch lists of client indices produced by the connection sweeps
+	std::vector<ClientIndex> m_SweepConnections{};
+	std::vector<ClientIndex> m_TimedOutConnections{};
+	std::string m_ConsoleText{};
+	std::function<void(const EventVariant&)> m_ConsoleEventHandler{ nullptr };
+	ServerMessageFn m_MessageHandler{ nullptr };
+	ServerDeliveryFn m_DeliveryHandler{ nullptr };
 	Socket m_ServerSocket;
+	UringSocket m_UringSocket;
+	bool m_UseIoUring{ false };
+	PacketBatch m_ReceiveBatch;
+	PacketPool m_PacketPool;
+	// Blocks that fragmented messages are reassembled in
+	PacketPool m_ReassemblyPool;
+	// Compresses sent packets and expands received ones into m_DecompressedPacket
+	PacketCompressor m_PacketCompressor;
+	std::array<uint8_t, k_MaxPacketSize> m_DecompressedPacket{};
+	std::array<PacketHandle, k_MaxPacketBatchSize> m_ReceivePackets{};
+	CoalescedPacket m_CoalescedPacket;
+	bool m_ReceiveCoalescing{ false };
+	PacketBatch m_SendBatch;
+	int m_SendBatchCount{ 0 };
+	NetworkReactor m_Reactor;
 	NetworkConfig m_Config;
 	KGThread m_NetworkThread;
-	KGThread m_NetworkEventThread;
 	LoopTimer m_ManageConnectionTimer;
-	PassiveLoopTimer m_KeepAliveTimer;
 	ConnectionList m_AllConnections;
 	EventQueue m_NetworkEventQueue;
 };
\ No newline at end of file
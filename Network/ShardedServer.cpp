@@ -0,0 +1,74 @@
+#include "ShardedServer.h"
+#include "../Util/Helper.h"
+
+bool ShardedServer::InitServer(const NetworkConfig& initConfig)
+{
+    KG_ASSERT(initConfig.m_NumServerShards > 0);
+
+    // Every shard needs a slice of at least one client index
+    if (initConfig.m_MaxClients < initConfig.m_NumServerShards)
+    {
+        TSLogger::Log("Failed to initialize server. Fewer clients allowed than server shards\n");
+        return false;
+    }
+
+    // Create all shards before any network thread starts so the handlers can see every shard
+    for (uint8_t shardIndex{ 0 }; shardIndex < initConfig.m_NumServerShards; shardIndex++)
+    {
+        Ref<Server> newShard = std::make_shared<Server>();
+        m_Shards.push_back(newShard);
+    }
+
+    // Console input is read by the first shard and shared with every shard
+    m_Shards[0]->SetConsoleEventHandler(KG_BIND_CLASS_FN(SubmitEvent));
+
+    // Start the shards in order (the bind order defines each socket's index in the reuse port group)
+    for (uint8_t shardIndex{ 0 }; shardIndex < initConfig.m_NumServerShards; shardIndex++)
+    {
+        if (!m_Shards[shardIndex]->InitServer(initConfig, shardIndex))
+        {
+            TSLogger::Log("Failed to initialize server shard %d\n", shardIndex);
+            m_Shards.resize(shardIndex);
+            TerminateServer();
+            return false;
+        }
+    }
+
+    // Steer packets to their owning shards (falls back to the kernel's hash if unavailable)
+    if (!m_Shards[0]->AttachShardSteeringProgram())
+    {
+        TSLogger::Log("Failed to attach the shard steering program\n");
+    }
+
+    return true;
+}
+
+bool ShardedServer::TerminateServer()
+{
+    for (Ref<Server>& shard : m_Shards)
+    {
+        shard->TerminateServer();
+    }
+    m_Shards.clear();
+
+    return true;
+}
+
+void ShardedServer::WaitOnServerTerminate()
+{
+    for (Ref<Server>& shard : m_Shards)
+    {
+        shard->WaitOnServerTerminate();
+    }
+}
+
+bool ShardedServer::SubmitEvent(const EventVariant& event)
+{
+    // Every shard is offered the event, even if another shard's queue is full
+    bool submitted{ true };
+    for (Ref<Server>& shard : m_Shards)
+    {
+        submitted &= shard->SubmitEvent(event);
+    }
+    return submitted;
+}
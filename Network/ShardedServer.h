@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Server.h"
+
+#include <vector>
+
+//==============================
+// Sharded Server Class
+//==============================
+// Runs several Server shards on the same port (SO_REUSEPORT). Each shard owns its own socket,
+//		network thread, connection management timer, and a disjoint slice of the client indices,
+//		so shards never share connection state and no global lock is required. A classic BPF
+//		program steers each datagram to the shard owning its client index and connection requests
+//		by the kernel's hash of their source address, so retried requests reach the same shard.
+class ShardedServer
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	ShardedServer() = default;
+	~ShardedServer() = default;
+
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	bool InitServer(const NetworkConfig& initConfig);
+	bool TerminateServer();
+
+	// Allows other threads to wait on all shards to close
+	void WaitOnServerTerminate();
+
+	//==============================
+	// Manage Events
+	//==============================
+	// Submit the event to every shard
+	// Returns false if the event queue is bounded and full
+	bool SubmitEvent(const EventVariant& event);
+private:
+	//==============================
+	// Internal Data
+	//==============================
+	std::vector<Ref<Server>> m_Shards{};
+};
@@ -1,66 +1,113 @@
 #include "Connection.h"
 #include "../Util/Logger.h"
 
+#include <bit>
+#include <cstring>
 
-ConnectionList::ConnectionList(ClientIndex maxClients) : m_MaxClients(maxClients)
+
+// Fibonacci hash of the combined address and port
+static size_t HashAddress(const Address& address)
+{
+	uint64_t key = ((uint64_t)address.GetAddress() << 16) | address.GetPort();
+	return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+ConnectionList::ConnectionList(ClientIndex maxClients, ClientIndex firstClientIndex, uint16_t reliableWindowSize) : 
+	m_MaxClients(maxClients), m_FirstClientIndex(firstClientIndex), m_ReliableWindowSize(reliableWindowSize)
 {
+	KG_ASSERT(maxClients < k_InvalidClientIndex);
+
 	m_AllConnections.resize(maxClients);
-	m_ClientsConnected.resize(maxClients);
+	m_SlotFlags.resize(maxClients);
+	m_ConnectionTimers.Init((uint32_t)maxClients * 2);
+
+	// Chain every slot into the free list (lowest index first)
+	m_NextFreeSlot.resize(maxClients);
+	for (ClientIndex iteration{ 0 }; iteration < maxClients; iteration++)
+	{
+		m_NextFreeSlot[iteration] = iteration + 1 < maxClients ? (ClientIndex)(iteration + 1) : k_InvalidClientIndex;
+	}
+	m_FreeSlotHead = maxClients > 0 ? 0 : k_InvalidClientIndex;
+
+	// Keep the address index at most half full
+	size_t indexSize{ 1 };
+	while (indexSize < (size_t)maxClients * 2)
+	{
+		indexSize <<= 1;
+	}
+	m_AddressIndex.assign(indexSize, k_InvalidClientIndex);
+	m_AddressIndexMask = indexSize - 1;
 }
 
 ClientIndex ConnectionList::AddConnection(Address newAddress)
 {
+	// Return the existing connection for repeated requests
+	ClientIndex existingIndex = FindConnection(newAddress);
+	if (existingIndex != k_InvalidClientIndex)
+	{
+		return existingIndex;
+	}
+
 	// Ensure number of clients are not already at capacity
-	if (m_NumClients >= m_MaxClients)
+	if (m_NumClients >= m_MaxClients || m_FreeSlotHead == k_InvalidClientIndex)
 	{
 		TSLogger::Log("Maximum number of connections reached");
 		return k_InvalidClientIndex;
 	}
 
-	// Check for an empty connection slot
-	ClientIndex iteration{ 0 };
-	for (bool connected : m_ClientsConnected)
-	{
-		if (!connected)
-		{
-			// Reset the connection
-			Connection& indicatedConnection = m_AllConnections[iteration];
-			m_ClientsConnected[iteration] = true;
-			indicatedConnection.m_Address = newAddress;
-			indicatedConnection.m_ReliabilityContext = ReliabilityContext();
+	// Take the first free slot
+	ClientIndex localIndex = m_FreeSlotHead;
+	m_FreeSlotHead = m_NextFreeSlot[localIndex];
 
-			// Update connection list state
-			m_NumClients++;
+	// Reset the connection
+	Connection& indicatedConnection = m_AllConnections[localIndex];
+	m_SlotFlags[localIndex] = ConnectionActive;
+	m_ConnectionTimers.Schedule(GetTimeoutTimerID(localIndex), m_TimeoutTicks);
+	m_ConnectionTimers.Schedule(GetKeepAliveTimerID(localIndex), m_KeepAliveTicks);
+	indicatedConnection.m_Address = newAddress;
+	indicatedConnection.m_ReliabilityContext = ReliabilityContext();
+	indicatedConnection.InitChannels(m_ReliableWindowSize);
+	indicatedConnection.m_PathMtuContext.Init(k_MinPacketSize);
+	indicatedConnection.m_OutgoingQueue.ClearQueue();
+	InsertAddress(localIndex);
 
-			// Return index
-			return iteration;
-		}
-		iteration++;
-	}
+	// Update connection list state
+	m_NumClients++;
 
-	// Failed to find an empty connection slot
-	TSLogger::Log("No connection slots are available");
-	return k_InvalidClientIndex;
+	// Return index
+	return m_FirstClientIndex + localIndex;
 }
 
 bool ConnectionList::RemoveConnection(ClientIndex clientIndex)
 {
 	// Check for out-of-bounds client
-	if (clientIndex >= m_ClientsConnected.size())
+	if (clientIndex < m_FirstClientIndex || (size_t)(clientIndex - m_FirstClientIndex) >= m_SlotFlags.size())
 	{
 		TSLogger::Log("Attempt to remove a client index that is out of bounds %d", clientIndex);
 		return false;
 	}
 
+	ClientIndex localIndex = clientIndex - m_FirstClientIndex;
+
 	// Check for already disconnected client
-	if (!m_ClientsConnected[clientIndex])
+	if (!(m_SlotFlags[localIndex] & ConnectionActive))
 	{
 		TSLogger::Log("Attempt to remove a client that is already disconnected %d", clientIndex);
 		return false;
 	}
 
 	// Remove the client
-	m_ClientsConnected[clientIndex] = false;
+	EraseAddress(localIndex);
+	m_SlotFlags[localIndex] = 0;
+	m_ConnectionTimers.Cancel(GetTimeoutTimerID(localIndex));
+	m_ConnectionTimers.Cancel(GetKeepAliveTimerID(localIndex));
+
+	// Return held reassembly blocks to their pool now rather than when the slot is reused
+	m_AllConnections[localIndex].ResetChannels();
+
+	// Return the slot to the free list
+	m_NextFreeSlot[localIndex] = m_FreeSlotHead;
+	m_FreeSlotHead = localIndex;
 
 	// Decriment the client count
 	KG_ASSERT(m_NumClients > 0);
@@ -71,11 +118,12 @@ bool ConnectionList::RemoveConnection(ClientIndex clientIndex)
 
 Connection* ConnectionList::GetConnection(ClientIndex clientIndex)
 {
-	if (clientIndex >= m_AllConnections.size() || !m_ClientsConnected[clientIndex])
+	if (clientIndex < m_FirstClientIndex || (size_t)(clientIndex - m_FirstClientIndex) >= m_AllConnections.size() ||
+		!(m_SlotFlags[clientIndex - m_FirstClientIndex] & ConnectionActive))
 	{
 		return nullptr;
 	}
-	return &m_AllConnections[clientIndex];
+	return &m_AllConnections[clientIndex - m_FirstClientIndex];
 }
 
 ClientIndex ConnectionList::GetNumberOfClients()
@@ -83,6 +131,11 @@ ClientIndex ConnectionList::GetNumberOfClients()
 	return m_NumClients;
 }
 
+ClientIndex ConnectionList::GetFirstClientIndex()
+{
+	return m_FirstClientIndex;
+}
+
 bool ConnectionList::IsConnectionActive(ClientIndex clientIndex)
 {
 	// Handle the defined null case
@@ -92,15 +145,418 @@ bool ConnectionList::IsConnectionActive(ClientIndex clientIndex)
 	}
 
 	// Handle weird case where out of bounds client is provided
-	if (clientIndex >= m_AllConnections.size())
+	if (clientIndex < m_FirstClientIndex || (size_t)(clientIndex - m_FirstClientIndex) >= m_AllConnections.size())
 	{
 		TSLogger::Log("Attempt to query if a client is connected that is out of bounds %d", clientIndex);
 		return false;
 	}
-	return m_ClientsConnected[clientIndex];
+	return m_SlotFlags[clientIndex - m_FirstClientIndex] & ConnectionActive;
+}
+
+ClientIndex ConnectionList::FindConnection(const Address& address)
+{
+	if (m_AddressIndex.empty())
+	{
+		return k_InvalidClientIndex;
+	}
+
+	ClientIndex localIndex = m_AddressIndex[FindAddressSlot(address)];
+	return localIndex == k_InvalidClientIndex ? k_InvalidClientIndex : (ClientIndex)(m_FirstClientIndex + localIndex);
+}
+
+void ConnectionList::SetTimerIntervals(uint32_t timeoutTicks, uint32_t keepAliveTicks)
+{
+	m_TimeoutTicks = timeoutTicks;
+	m_KeepAliveTicks = keepAliveTicks;
+}
+
+void ConnectionList::AdvanceTick(std::vector<ClientIndex>& timedOutConnections, std::vector<ClientIndex>& keepAliveConnections)
+{
+	// Only the timers expiring on this tick are visited
+	m_ExpiredTimers.clear();
+	m_ConnectionTimers.Advance(m_ExpiredTimers);
+
+	for (uint32_t timerID : m_ExpiredTimers)
+	{
+		ClientIndex localIndex = (ClientIndex)(timerID / 2);
+		KG_ASSERT(m_SlotFlags[localIndex] & ConnectionActive);
+
+		if (timerID == GetTimeoutTimerID(localIndex))
+		{
+			timedOutConnections.push_back(m_FirstClientIndex + localIndex);
+			continue;
+		}
+
+		// Keep the keep-alive running even if the caller fails to send a packet
+		keepAliveConnections.push_back(m_FirstClientIndex + localIndex);
+		m_ConnectionTimers.Schedule(timerID, GetKeepAliveDelay(localIndex));
+	}
+}
+
+void ConnectionList::OnPacketReceived(ClientIndex clientIndex)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	m_ConnectionTimers.Schedule(GetTimeoutTimerID(clientIndex - m_FirstClientIndex), m_TimeoutTicks);
+}
+
+void ConnectionList::OnPacketSent(ClientIndex clientIndex)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	ClientIndex localIndex = clientIndex - m_FirstClientIndex;
+	m_ConnectionTimers.Schedule(GetKeepAliveTimerID(localIndex), GetKeepAliveDelay(localIndex));
+}
+
+void ConnectionList::SetConnectionCongested(ClientIndex clientIndex, bool congested)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	uint8_t& flags = m_SlotFlags[clientIndex - m_FirstClientIndex];
+	flags = congested ? (uint8_t)(flags | ConnectionCongested) : (uint8_t)(flags & ~ConnectionCongested);
+}
+
+void ConnectionList::SetConnectionReassembling(ClientIndex clientIndex, bool reassembling)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	uint8_t& flags = m_SlotFlags[clientIndex - m_FirstClientIndex];
+	flags = reassembling ? (uint8_t)(flags | ConnectionReassembling) : (uint8_t)(flags & ~ConnectionReassembling);
+}
+
+void ConnectionList::SetConnectionProbing(ClientIndex clientIndex, bool probing)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	uint8_t& flags = m_SlotFlags[clientIndex - m_FirstClientIndex];
+	flags = probing ? (uint8_t)(flags | ConnectionProbing) : (uint8_t)(flags & ~ConnectionProbing);
+}
+
+void ConnectionList::SetConnectionOutboxPending(ClientIndex clientIndex, bool pending)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	uint8_t& flags = m_SlotFlags[clientIndex - m_FirstClientIndex];
+	flags = pending ? (uint8_t)(flags | ConnectionOutboxPending) : (uint8_t)(flags & ~ConnectionOutboxPending);
+}
+
+void ConnectionList::SetConnectionQueuePending(ClientIndex clientIndex, bool pending)
+{
+	KG_ASSERT(IsConnectionActive(clientIndex));
+	uint8_t& flags = m_SlotFlags[clientIndex - m_FirstClientIndex];
+	flags = pending ? (uint8_t)(flags | ConnectionQueuePending) : (uint8_t)(flags & ~ConnectionQueuePending);
+}
+
+void ConnectionList::GetConnectionsWithFlags(uint8_t requiredFlags, uint8_t excludedFlags, std::vector<ClientIndex>& connections)
+{
+	constexpr size_t k_ChunkSize{ 64 };
+	const uint8_t matchMask = requiredFlags | excludedFlags | ConnectionActive;
+	const uint8_t matchValue = requiredFlags | ConnectionActive;
+	const uint8_t* flags = m_SlotFlags.data();
+	size_t numSlots = m_SlotFlags.size();
+
+	for (size_t chunkStart{ 0 }; chunkStart < numSlots; chunkStart += k_ChunkSize)
+	{
+		size_t chunkSize = numSlots - chunkStart < k_ChunkSize ? numSlots - chunkStart : k_ChunkSize;
+
+		// Branch-free compare of a chunk of packed flags into a bit mask (vectorizable)
+		uint64_t matches{ 0 };
+		for (size_t slot{ 0 }; slot < chunkSize; slot++)
+		{
+			matches |= (uint64_t)((flags[chunkStart + slot] & matchMask) == matchValue) << slot;
+		}
+
+		// Only the matching slots are visited
+		while (matches)
+		{
+			size_t slot = (size_t)std::countr_zero(matches);
+			matches &= matches - 1;
+			connections.push_back((ClientIndex)(m_FirstClientIndex + chunkStart + slot));
+		}
+	}
 }
 
 std::vector<Connection>& ConnectionList::GetAllConnections()
 {
 	return m_AllConnections;
 }
+
+uint32_t ConnectionList::GetTimeoutTimerID(ClientIndex localIndex) const
+{
+	return (uint32_t)localIndex * 2;
+}
+
+uint32_t ConnectionList::GetKeepAliveTimerID(ClientIndex localIndex) const
+{
+	return (uint32_t)localIndex * 2 + 1;
+}
+
+uint32_t ConnectionList::GetKeepAliveDelay(ClientIndex localIndex) const
+{
+	// Congested connections are only kept alive every third interval
+	return m_SlotFlags[localIndex] & ConnectionCongested ? m_KeepAliveTicks * 3 : m_KeepAliveTicks;
+}
+
+size_t ConnectionList::FindAddressSlot(const Address& address)
+{
+	// Probe until the address or an empty entry is found (the index is never full)
+	size_t slot = HashAddress(address) & m_AddressIndexMask;
+	while (m_AddressIndex[slot] != k_InvalidClientIndex &&
+		!(m_AllConnections[m_AddressIndex[slot]].m_Address == address))
+	{
+		slot = (slot + 1) & m_AddressIndexMask;
+	}
+	return slot;
+}
+
+void ConnectionList::InsertAddress(ClientIndex localIndex)
+{
+	size_t slot = FindAddressSlot(m_AllConnections[localIndex].m_Address);
+	KG_ASSERT(m_AddressIndex[slot] == k_InvalidClientIndex);
+	m_AddressIndex[slot] = localIndex;
+}
+
+void ConnectionList::EraseAddress(ClientIndex localIndex)
+{
+	size_t hole = FindAddressSlot(m_AllConnections[localIndex].m_Address);
+	KG_ASSERT(m_AddressIndex[hole] == localIndex);
+
+	// Shift later entries of the probe run back into the hole so no tombstones are needed
+	size_t next = (hole + 1) & m_AddressIndexMask;
+	while (m_AddressIndex[next] != k_InvalidClientIndex)
+	{
+		size_t idealSlot = HashAddress(m_AllConnections[m_AddressIndex[next]].m_Address) & m_AddressIndexMask;
+
+		// Move the entry if the hole lies between its ideal slot and its current slot
+		if (((next - idealSlot) & m_AddressIndexMask) >= ((next - hole) & m_AddressIndexMask))
+		{
+			m_AddressIndex[hole] = m_AddressIndex[next];
+			hole = next;
+		}
+		next = (next + 1) & m_AddressIndexMask;
+	}
+
+	m_AddressIndex[hole] = k_InvalidClientIndex;
+}
+
+void Connection::InitChannels(uint16_t reliableWindowSize)
+{
+	m_ReliableChannel.Init(ChannelType::Reliable, reliableWindowSize);
+	m_OrderedChannel.Init(ChannelType::ReliableOrdered, reliableWindowSize);
+	m_UnreliableChannel.Init(ChannelType::Unreliable);
+	m_SequencedChannel.Init(ChannelType::UnreliableSequenced);
+	m_SnapshotContext.Reset();
+}
+
+void Connection::ResetChannels()
+{
+	ReleaseReservedBlocks();
+	m_ReliableChannel.Reset();
+	m_OrderedChannel.Reset();
+	m_UnreliableChannel.Reset();
+	m_SequencedChannel.Reset();
+	m_SnapshotContext.Reset();
+}
+
+ReliableChannel* Connection::GetReliableChannel(ChannelType channel)
+{
+	switch (channel)
+	{
+	case ChannelType::Reliable:
+		return &m_ReliableChannel;
+	case ChannelType::ReliableOrdered:
+		return &m_OrderedChannel;
+	default:
+		return nullptr;
+	}
+}
+
+UnreliableChannel* Connection::GetUnreliableChannel(ChannelType channel)
+{
+	switch (channel)
+	{
+	case ChannelType::Unreliable:
+		return &m_UnreliableChannel;
+	case ChannelType::UnreliableSequenced:
+		return &m_SequencedChannel;
+	default:
+		return nullptr;
+	}
+}
+
+bool Connection::QueueMessage(ChannelType channel, const void* data, int size, uint16_t& messageID)
+{
+	ReliableChannel* reliableChannel = GetReliableChannel(channel);
+	if (reliableChannel)
+	{
+		return reliableChannel->QueueMessage(data, size, messageID);
+	}
+
+	if (channel == ChannelType::Snapshot)
+	{
+		return m_SnapshotContext.QueueSnapshot(data, size, messageID);
+	}
+
+	UnreliableChannel* unreliableChannel = GetUnreliableChannel(channel);
+	KG_ASSERT(unreliableChannel);
+	return unreliableChannel->QueueMessage(data, size, messageID);
+}
+
+bool Connection::HasMessagesToSend(float resendDelay) const
+{
+	return m_OrderedChannel.HasMessagesToSend(resendDelay) || m_ReliableChannel.HasMessagesToSend(resendDelay) ||
+		m_SnapshotContext.HasSnapshotToSend() || m_SequencedChannel.HasQueuedMessages() || m_UnreliableChannel.HasQueuedMessages();
+}
+
+bool Connection::IsSendingFragments() const
+{
+	return m_ReliableChannel.IsSendingFragments() || m_OrderedChannel.IsSendingFragments();
+}
+
+bool Connection::ReserveReceiveBlocks(const uint8_t* buffer, int size, bool pooled, PacketPool& packetPool, PacketPool& reassemblyPool)
+{
+	ReleaseReservedBlocks();
+
+	MessageRecord record;
+	int offset{ (int)k_PacketHeaderSize };
+	while (offset < size)
+	{
+		// Malformed records are reported when the messages are received
+		int recordSize = ReadMessageRecord(&buffer[offset], size - offset, record);
+		if (recordSize == 0)
+		{
+			return true;
+		}
+		offset += recordSize;
+
+		ReliableChannel* reliableChannel = GetReliableChannel(record.m_Channel);
+		if (!reliableChannel)
+		{
+			continue;
+		}
+
+		if (!reliableChannel->ReserveReassemblyBlock(record, reassemblyPool))
+		{
+			ReleaseReservedBlocks();
+			return false;
+		}
+
+		// Whole messages outside the pool are copied into it when received
+		if (!pooled && record.m_FragmentCount == 0 && reliableChannel->IsNewMessage(record.m_MessageID))
+		{
+			PacketHandle block = packetPool.Acquire();
+			if (!block)
+			{
+				ReleaseReservedBlocks();
+				return false;
+			}
+			m_ReservedBlocks.push_back(std::move(block));
+		}
+	}
+	return true;
+}
+
+void Connection::ReleaseReservedBlocks()
+{
+	m_ReservedBlocks.clear();
+}
+
+PacketHandle Connection::HoldReliableMessage(const MessageRecord& record, const PacketHandle& pooledPacket)
+{
+	// View the message in the pooled packet it was received in
+	const uint8_t* packetBuffer = pooledPacket ? pooledPacket.GetBuffer() : nullptr;
+	if (packetBuffer && record.m_Data >= packetBuffer && record.m_Data + record.m_Size <= packetBuffer + pooledPacket.GetSize())
+	{
+		PacketHandle message{ pooledPacket };
+		message.SetPayload((int)(record.m_Data - packetBuffer), record.m_Size);
+		return message;
+	}
+
+	// Copy it into a block reserved before the packet was acknowledged
+	KG_ASSERT(!m_ReservedBlocks.empty());
+	PacketHandle message = std::move(m_ReservedBlocks.back());
+	m_ReservedBlocks.pop_back();
+	memcpy(message.GetBuffer() + k_PacketHeaderSize, record.m_Data, record.m_Size);
+	message.SetContents(m_Address, (int)k_PacketHeaderSize + record.m_Size);
+	return message;
+}
+
+bool Connection::IsReassembling() const
+{
+	return m_ReliableChannel.IsReassembling() || m_OrderedChannel.IsReassembling();
+}
+
+bool Connection::IsReassemblyStalled(float timeout) const
+{
+	return m_ReliableChannel.IsReassemblyStalled(timeout) || m_OrderedChannel.IsReassemblyStalled(timeout);
+}
+
+int Connection::WriteMessages(uint16_t packetSequence, uint8_t* buffer, int capacity, const ChannelBudgets& budgets, float resendDelay)
+{
+	int bytesWritten{ 0 };
+
+	// Reliable channels always claim their packet sequence entry, even when they write nothing
+	for (ReliableChannel* channel : { &m_OrderedChannel, &m_ReliableChannel })
+	{
+		bytesWritten += channel->WriteMessages(packetSequence, &buffer[bytesWritten], capacity - bytesWritten,
+			budgets[(size_t)channel->GetChannelType()], resendDelay);
+	}
+
+	// A snapshot is a single record, so it is only limited by the capacity
+	bytesWritten += m_SnapshotContext.WriteSnapshot(packetSequence, &buffer[bytesWritten], capacity - bytesWritten);
+
+	for (UnreliableChannel* channel : { &m_SequencedChannel, &m_UnreliableChannel })
+	{
+		bytesWritten += channel->WriteMessages(&buffer[bytesWritten], capacity - bytesWritten,
+			budgets[(size_t)channel->GetChannelType()]);
+	}
+
+	return bytesWritten;
+}
+
+uint8_t* OutgoingPacketQueue::GetNextPacketLocation()
+{
+	if (m_PacketCount >= k_MaxOutgoingQueueSize)
+	{
+		return nullptr;
+	}
+
+	if (m_Buffer.empty())
+	{
+		m_Buffer.resize(k_MaxOutgoingQueueSize * k_MaxPacketSize);
+	}
+	return &m_Buffer[m_BufferSize];
+}
+
+void OutgoingPacketQueue::CommitPacket(int packetSize)
+{
+	KG_ASSERT(m_PacketCount < k_MaxOutgoingQueueSize);
+	KG_ASSERT(packetSize > 0 && packetSize <= (int)k_MaxPacketSize);
+
+	m_PacketOffsets[m_PacketCount] = m_BufferSize;
+	m_PacketSizes[m_PacketCount] = packetSize;
+	m_PacketCount++;
+	m_BufferSize += packetSize;
+}
+
+void OutgoingPacketQueue::ClearQueue()
+{
+	m_PacketCount = 0;
+	m_BufferSize = 0;
+}
+
+bool OutgoingPacketQueue::IsEmpty() const
+{
+	return m_PacketCount == 0;
+}
+
+int OutgoingPacketQueue::GetPacketCount() const
+{
+	return m_PacketCount;
+}
+
+int OutgoingPacketQueue::GetPacketSize(int packetIndex) const
+{
+	KG_ASSERT(packetIndex < m_PacketCount);
+	return m_PacketSizes[packetIndex];
+}
+
+const uint8_t* OutgoingPacketQueue::GetPacketData(int packetIndex) const
+{
+	KG_ASSERT(packetIndex < m_PacketCount);
+	return &m_Buffer[m_PacketOffsets[packetIndex]];
+}
@@ -4,13 +4,176 @@
 #include "Address.h"
 #include "../Network/NetworkCommon.h"
 #include "ReliabilityContext.h"
+#include "ReliableChannel.h"
+#include "UnreliableChannel.h"
+#include "SnapshotContext.h"
+#include "PathMtuContext.h"
+#include "../Util/TimingWheel.h"
 
 #include <vector>
+#include <array>
+#include <cstdint>
 
+constexpr int k_MaxOutgoingQueueSize{ 8 };
+// Packets a keep-alive tick may add to drain resends that are due (e.g. lost fragments)
+constexpr int k_MaxResendPacketsPerTick{ 8 };
+
+class OutgoingPacketQueue
+{
+public:
+	//==============================
+	// Modify Queue
+	//==============================
+	// Get the location to write the next packet (nullptr if the queue is full)
+	uint8_t* GetNextPacketLocation();
+	// Add the packet written to GetNextPacketLocation() to the queue
+	void CommitPacket(int packetSize);
+	void ClearQueue();
+
+	//==============================
+	// Query Queue
+	//==============================
+	bool IsEmpty() const;
+	int GetPacketCount() const;
+	int GetPacketSize(int packetIndex) const;
+	// Packets are stored back-to-back so equal sized runs can be sent as one segmented buffer
+	const uint8_t* GetPacketData(int packetIndex) const;
+private:
+	//==============================
+	// Internal Data
+	//==============================
+	// Allocated on the first queued packet, so idle connection slots stay small
+	std::vector<uint8_t> m_Buffer{};
+	std::array<int, k_MaxOutgoingQueueSize> m_PacketSizes;
+	std::array<int, k_MaxOutgoingQueueSize> m_PacketOffsets;
+	int m_PacketCount{ 0 };
+	int m_BufferSize{ 0 };
+};
+
+// Every channel of a connection shares the connection's packet sequence numbers, so messages of
+//		all channels are packed into the same datagrams
 struct Connection
 {
 	Address m_Address;
 	ReliabilityContext m_ReliabilityContext{};
+	ReliableChannel m_ReliableChannel{};
+	ReliableChannel m_OrderedChannel{};
+	UnreliableChannel m_UnreliableChannel{};
+	UnreliableChannel m_SequencedChannel{};
+	SnapshotContext m_SnapshotContext{};
+	// Packet size of this end's sends
+	PathMtuContext m_PathMtuContext{};
+	// Packets waiting to be flushed on the next connection management tick
+	OutgoingPacketQueue m_OutgoingQueue{};
+	// Packet pool blocks reserved for the reliable messages of the packet being received
+	std::vector<PacketHandle> m_ReservedBlocks{};
+
+	// Set up every channel for a new connection
+	void InitChannels(uint16_t reliableWindowSize);
+	void ResetChannels();
+	// Returns the channel of the provided type (nullptr if the type belongs to the other class)
+	ReliableChannel* GetReliableChannel(ChannelType channel);
+	UnreliableChannel* GetUnreliableChannel(ChannelType channel);
+	// Queue a message on any channel. Returns false if the message is too large or the channel is full.
+	bool QueueMessage(ChannelType channel, const void* data, int size, uint16_t& messageID);
+	// True if a queued message or fragment still needs its first send or is due for resending
+	bool HasMessagesToSend(float resendDelay) const;
+	// True while a fragmented message on either reliable channel waits on acks of its fragments
+	bool IsSendingFragments() const;
+	// Write the messages of every channel in priority order (reliable-ordered, reliable, snapshot,
+	//		unreliable-sequenced, unreliable), each limited to its budget. Returns the bytes written.
+	int WriteMessages(uint16_t packetSequence, uint8_t* buffer, int capacity, const ChannelBudgets& budgets, float resendDelay);
+	// Pass a received record to its channel. The handler (const uint8_t* data, int size,
+	//		const PacketHandle& message) is called with each message that can be delivered, the
+	//		message is valid for reliable channels. The pooled packet is valid when the record was
+	//		received directly into the packet pool.
+	template<typename DeliverFn>
+	void ReceiveMessage(const MessageRecord& record, const PacketHandle& pooledPacket, DeliverFn&& deliver);
+	// Reserve the blocks the packet's new reliable messages need before the packet is acknowledged,
+	//		reassembly blocks for fragments and packet pool blocks for copies of whole messages that
+	//		were not received into the pool. Returns false if a pool is exhausted, the packet is then
+	//		dropped unacknowledged so the peer resends it.
+	bool ReserveReceiveBlocks(const uint8_t* buffer, int size, bool pooled, PacketPool& packetPool, PacketPool& reassemblyPool);
+	// Return the reserved blocks the packet's messages did not use
+	void ReleaseReservedBlocks();
+	// Pooled block holding a whole reliable message, a view of the pooled packet it was received
+	//		in or a copy in a reserved block
+	PacketHandle HoldReliableMessage(const MessageRecord& record, const PacketHandle& pooledPacket);
+	// True while a fragmented message is being reassembled
+	bool IsReassembling() const;
+	// True if a reassembly received no fragment for the timeout (the peer stopped sending them)
+	bool IsReassemblyStalled(float timeout) const;
+	// Mark the reliable messages carried by newly acknowledged packets as delivered. The handler is
+	//		called with the channel and message ID of each delivered message.
+	template<typename DeliveredFn>
+	void OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField, DeliveredFn&& onDelivered);
+};
+
+template<typename DeliverFn>
+void Connection::ReceiveMessage(const MessageRecord& record, const PacketHandle& pooledPacket, DeliverFn&& deliver)
+{
+	// Snapshots are decoded against their baseline
+	if (record.m_Channel == ChannelType::Snapshot)
+	{
+		const uint8_t* state{ nullptr };
+		int stateSize{ 0 };
+		if (m_SnapshotContext.ReceiveSnapshot(record.m_MessageID, record.m_Data, record.m_Size, state, stateSize))
+		{
+			deliver(state, stateSize, PacketHandle{});
+		}
+		return;
+	}
+
+	// Reliable channels drop resent duplicates, reassemble fragments, and hold ordered messages
+	//		until they are next
+	ReliableChannel* reliableChannel = GetReliableChannel(record.m_Channel);
+	if (reliableChannel)
+	{
+		// Whole messages are held in a pooled block, so buffering and delivering them never allocates
+		PacketHandle message{};
+		if (record.m_FragmentCount == 0 && reliableChannel->IsNewMessage(record.m_MessageID))
+		{
+			message = HoldReliableMessage(record, pooledPacket);
+		}
+		reliableChannel->ReceiveMessage(record, m_Address, std::move(message), deliver);
+		return;
+	}
+
+	// Sequenced channels drop stale messages
+	UnreliableChannel* unreliableChannel = GetUnreliableChannel(record.m_Channel);
+	if (unreliableChannel && unreliableChannel->ReceiveMessage(record.m_MessageID))
+	{
+		deliver(record.m_Data, record.m_Size, PacketHandle{});
+	}
+}
+
+template<typename DeliveredFn>
+void Connection::OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField, DeliveredFn&& onDelivered)
+{
+	m_SnapshotContext.OnPacketsAcknowledged(newestSequence, acknowledgedField);
+
+	for (ReliableChannel* channel : { &m_ReliableChannel, &m_OrderedChannel })
+	{
+		channel->OnPacketsAcknowledged(newestSequence, acknowledgedField, [&](uint16_t messageID)
+			{
+				onDelivered(channel->GetChannelType(), messageID);
+			});
+	}
+}
+
+// Bits of the packed per-slot flags
+enum ConnectionFlags : uint8_t
+{
+	ConnectionActive = 1 << 0,
+	ConnectionCongested = 1 << 1,
+	// A reassembly holds a reassembly pool block and needs to be checked for its timeout
+	ConnectionReassembling = 1 << 2,
+	// The path MTU search is running and may need a probe sent
+	ConnectionProbing = 1 << 3,
+	// Messages were queued since the last connection management tick and need to be flushed
+	ConnectionOutboxPending = 1 << 4,
+	// Packets wait in the outgoing queue to be sent at the end of the connection management tick
+	ConnectionQueuePending = 1 << 5
 };
 
 class ConnectionList
@@ -20,11 +183,14 @@ public:
 	// Constructors/Destructors
 	//==============================
 	ConnectionList() = default;
-	ConnectionList(ClientIndex maxClients);
+	// A list may own a slice of the client index space starting at firstClientIndex
+	ConnectionList(ClientIndex maxClients, ClientIndex firstClientIndex = 0,
+		uint16_t reliableWindowSize = k_DefaultReliableWindowSize);
 public:
 	//==============================
 	// Manage Connections
 	//==============================
+	// Adding an address that is already connected returns its existing index
 	ClientIndex AddConnection(Address newAddress);
 	bool RemoveConnection(ClientIndex clientIndex);
 
@@ -32,19 +198,76 @@ public:
 	// Query Context
 	//==============================
 	bool IsConnectionActive(ClientIndex clientIndex);
+	// Returns the index of the connection with the provided address (k_InvalidClientIndex if none)
+	ClientIndex FindConnection(const Address& address);
+
+	//==============================
+	// Hot Connection State
+	//==============================
+	// Set the timeout and keep-alive intervals in connection management ticks
+	void SetTimerIntervals(uint32_t timeoutTicks, uint32_t keepAliveTicks);
+	// Advance the connection timers one tick and append the connections whose timer expired
+	void AdvanceTick(std::vector<ClientIndex>& timedOutConnections, std::vector<ClientIndex>& keepAliveConnections);
+	// Reschedule the timeout after a valid packet is received
+	void OnPacketReceived(ClientIndex clientIndex);
+	// Reschedule the keep-alive after a packet is sent (congested connections wait longer)
+	void OnPacketSent(ClientIndex clientIndex);
+	// Mirror the reliability context's congestion state into the packed flags
+	void SetConnectionCongested(ClientIndex clientIndex, bool congested);
+	// Mirror the connection's reassembly state into the packed flags
+	void SetConnectionReassembling(ClientIndex clientIndex, bool reassembling);
+	// Mirror the connection's path MTU search state into the packed flags
+	void SetConnectionProbing(ClientIndex clientIndex, bool probing);
+	// Mark the connection's outbox for the next flush (cleared once flushed)
+	void SetConnectionOutboxPending(ClientIndex clientIndex, bool pending);
+	// Mark the connection's outgoing queue as holding packets (cleared once flushed)
+	void SetConnectionQueuePending(ClientIndex clientIndex, bool pending);
+	// Append the active connections whose flags match (all required bits set, no excluded bits set)
+	void GetConnectionsWithFlags(uint8_t requiredFlags, uint8_t excludedFlags, std::vector<ClientIndex>& connections);
 
 	//==============================
 	// Getters/Setters
 	//==============================
 	Connection* GetConnection(ClientIndex clientIndex);
 	ClientIndex GetNumberOfClients();
+	ClientIndex GetFirstClientIndex();
 	std::vector<Connection>& GetAllConnections();
+private:
+	// Connection timer helpers (use local slot indices)
+	uint32_t GetTimeoutTimerID(ClientIndex localIndex) const;
+	uint32_t GetKeepAliveTimerID(ClientIndex localIndex) const;
+	uint32_t GetKeepAliveDelay(ClientIndex localIndex) const;
+	// Address index helpers (use local slot indices)
+	size_t FindAddressSlot(const Address& address);
+	void InsertAddress(ClientIndex localIndex);
+	void EraseAddress(ClientIndex localIndex);
 private:
 	//==============================
 	// Internal Data
 	//==============================
 	ClientIndex m_MaxClients{ 0 };
 	ClientIndex m_NumClients{ 0 };
+	ClientIndex m_FirstClientIndex{ 0 };
+	uint16_t m_ReliableWindowSize{ k_DefaultReliableWindowSize };
+	// Cold per-slot state (addresses, reliability history, outgoing queues)
 	std::vector<Connection> m_AllConnections{};
-	std::vector<bool> m_ClientsConnected{};
+
+	// Hot per-slot state, packed so the per-tick sweeps stream over a few bytes per connection
+	//		instead of striding across the Connection structures
+	std::vector<uint8_t> m_SlotFlags{};
+
+	// Each slot owns a timeout timer and a keep-alive timer (IDs localIndex * 2 and localIndex * 2 + 1)
+	TimingWheel m_ConnectionTimers{};
+	std::vector<uint32_t> m_ExpiredTimers{};
+	uint32_t m_TimeoutTicks{ 600 };
+	uint32_t m_KeepAliveTicks{ 3 };
+
+	// Intrusive free list, each free slot holds the local index of the next free slot
+	std::vector<ClientIndex> m_NextFreeSlot{};
+	ClientIndex m_FreeSlotHead{ k_InvalidClientIndex };
+
+	// Open addressing (linear probing) index from address to local slot. Sized to a power of two
+	//		at least twice the maximum client count, empty entries hold k_InvalidClientIndex.
+	std::vector<ClientIndex> m_AddressIndex{};
+	size_t m_AddressIndexMask{ 0 };
 };
\ No newline at end of file
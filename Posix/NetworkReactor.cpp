@@ -0,0 +1,319 @@
+#include "NetworkReactor.h"
+
+#if PLATFORM == PLATFORM_UNIX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <cerrno>
+
+// Console mode is process wide, so the original mode is stored statically
+static termios s_OriginalConsoleMode;
+#endif
+
+#if PLATFORM == PLATFORM_WINDOWS
+
+bool NetworkReactor::Init(int socketHandle, bool watchConsoleInput)
+{
+	m_SocketHandle = socketHandle;
+	m_WatchConsoleInput = watchConsoleInput;
+
+	// Create network event
+	m_NetworkEvent = WSACreateEvent();
+	if (WSAEventSelect(m_SocketHandle, m_NetworkEvent, FD_READ) != 0)
+	{
+		TSLogger::Log("Failed to create the network event handle\n");
+		return false;
+	}
+
+	// Create the auto-reset wakeup event
+	m_WakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (!m_WakeEvent)
+	{
+		TSLogger::Log("Failed to create the reactor wakeup event\n");
+		return false;
+	}
+
+	// Create the auto-reset periodic timer
+	m_TimerHandle = CreateWaitableTimer(nullptr, FALSE, nullptr);
+	if (!m_TimerHandle)
+	{
+		TSLogger::Log("Failed to create the reactor timer\n");
+		return false;
+	}
+
+	if (m_WatchConsoleInput)
+	{
+		// Get console input handle
+		m_ConsoleHandle = GetStdHandle(STD_INPUT_HANDLE);
+		SetConsoleMode(m_ConsoleHandle, 0);
+	}
+
+	return true;
+}
+
+void NetworkReactor::Terminate()
+{
+	if (m_NetworkEvent)
+	{
+		WSACloseEvent(m_NetworkEvent);
+		m_NetworkEvent = nullptr;
+	}
+	if (m_WakeEvent)
+	{
+		CloseHandle(m_WakeEvent);
+		m_WakeEvent = nullptr;
+	}
+	if (m_TimerHandle)
+	{
+		CancelWaitableTimer(m_TimerHandle);
+		CloseHandle(m_TimerHandle);
+		m_TimerHandle = nullptr;
+	}
+	m_ConsoleHandle = nullptr;
+}
+
+BitField<uint8_t> NetworkReactor::Wait(int timeoutMs)
+{
+	BitField<uint8_t> readyEvents{ 0 };
+
+	// Wait for any of the events (order matches the ReactorEvent flags)
+	HANDLE allEvents[4]{ m_NetworkEvent, m_WakeEvent, m_TimerHandle, m_ConsoleHandle };
+	DWORD numEvents = m_WatchConsoleInput ? 4 : 3;
+	DWORD waitResult = WaitForMultipleObjects(numEvents, allEvents, FALSE,
+		timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+
+	if (waitResult >= WAIT_OBJECT_0 + numEvents)
+	{
+		return readyEvents;
+	}
+
+	// WaitForMultipleObjects only reports the lowest signaled handle, so poll the rest
+	for (DWORD iteration{ waitResult - WAIT_OBJECT_0 }; iteration < numEvents; iteration++)
+	{
+		if (iteration != waitResult - WAIT_OBJECT_0 &&
+			WaitForSingleObject(allEvents[iteration], 0) != WAIT_OBJECT_0)
+		{
+			continue;
+		}
+
+		if (iteration == ReactorEvent::SocketReadable)
+		{
+			// Reset the network event and check the event type
+			WSANETWORKEVENTS netEvents;
+			WSAEnumNetworkEvents(m_SocketHandle, m_NetworkEvent, &netEvents);
+			if (!(netEvents.lNetworkEvents & FD_READ))
+			{
+				continue;
+			}
+		}
+
+		readyEvents.SetFlag((uint8_t)iteration);
+	}
+
+	return readyEvents;
+}
+
+void NetworkReactor::Wake()
+{
+	SetEvent(m_WakeEvent);
+}
+
+void NetworkReactor::StartTimer(std::chrono::nanoseconds interval)
+{
+	// Due time is relative (negative) and in 100 nanosecond units
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(LONGLONG)(interval.count() / 100);
+	LONG periodMs = (LONG)std::chrono::duration_cast<std::chrono::milliseconds>(interval).count();
+
+	if (!SetWaitableTimer(m_TimerHandle, &dueTime, periodMs > 0 ? periodMs : 1, nullptr, nullptr, FALSE))
+	{
+		TSLogger::Log("Failed to start the reactor timer\n");
+	}
+}
+
+void NetworkReactor::StopTimer()
+{
+	CancelWaitableTimer(m_TimerHandle);
+}
+
+int NetworkReactor::ReadConsoleKeys(char* keys, int maxKeys)
+{
+	INPUT_RECORD inputRecord;
+	DWORD eventsRead;
+	int numKeys{ 0 };
+
+	while (numKeys < maxKeys)
+	{
+		DWORD numEvents;
+		if (!GetNumberOfConsoleInputEvents(m_ConsoleHandle, &numEvents) || numEvents == 0)
+			break;  // No more events, exit the loop
+
+		if (ReadConsoleInput(m_ConsoleHandle, &inputRecord, 1, &eventsRead))
+		{
+			if (inputRecord.EventType == KEY_EVENT && inputRecord.Event.KeyEvent.bKeyDown)
+			{
+				keys[numKeys++] = inputRecord.Event.KeyEvent.uChar.AsciiChar;
+			}
+		}
+	}
+
+	return numKeys;
+}
+
+#elif PLATFORM == PLATFORM_UNIX
+
+bool NetworkReactor::Init(int socketHandle, bool watchConsoleInput)
+{
+	m_SocketHandle = socketHandle;
+	m_WatchConsoleInput = watchConsoleInput;
+
+	m_EpollHandle = epoll_create1(EPOLL_CLOEXEC);
+	if (m_EpollHandle == -1)
+	{
+		TSLogger::Log("Failed to create the epoll instance: %d\n", errno);
+		return false;
+	}
+
+	// Create the wakeup and timer handles
+	m_WakeHandle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	m_TimerHandle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (m_WakeHandle == -1 || m_TimerHandle == -1)
+	{
+		TSLogger::Log("Failed to create the reactor wakeup/timer handles: %d\n", errno);
+		Terminate();
+		return false;
+	}
+
+	// Register all handles (the flag index is stored as the user data)
+	auto registerHandle = [&](int handle, ReactorEvent flag)
+	{
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u32 = flag;
+		return epoll_ctl(m_EpollHandle, EPOLL_CTL_ADD, handle, &event) == 0;
+	};
+
+	if (!registerHandle(m_SocketHandle, ReactorEvent::SocketReadable) ||
+		!registerHandle(m_WakeHandle, ReactorEvent::QueueWakeup) ||
+		!registerHandle(m_TimerHandle, ReactorEvent::TimerTick))
+	{
+		TSLogger::Log("Failed to register reactor handles: %d\n", errno);
+		Terminate();
+		return false;
+	}
+
+	if (m_WatchConsoleInput)
+	{
+		// Switch the terminal to unbuffered/no-echo input, similar to SetConsoleMode(0)
+		if (tcgetattr(STDIN_FILENO, &s_OriginalConsoleMode) == 0)
+		{
+			termios rawMode = s_OriginalConsoleMode;
+			rawMode.c_lflag &= ~(ICANON | ECHO);
+			rawMode.c_cc[VMIN] = 0;
+			rawMode.c_cc[VTIME] = 0;
+			tcsetattr(STDIN_FILENO, TCSANOW, &rawMode);
+		}
+
+		if (!registerHandle(STDIN_FILENO, ReactorEvent::ConsoleInput))
+		{
+			TSLogger::Log("Failed to register console input with the reactor\n");
+			m_WatchConsoleInput = false;
+		}
+	}
+
+	return true;
+}
+
+void NetworkReactor::Terminate()
+{
+	if (m_WatchConsoleInput)
+	{
+		tcsetattr(STDIN_FILENO, TCSANOW, &s_OriginalConsoleMode);
+		m_WatchConsoleInput = false;
+	}
+
+	for (int* handle : { &m_EpollHandle, &m_WakeHandle, &m_TimerHandle })
+	{
+		if (*handle != -1)
+		{
+			close(*handle);
+			*handle = -1;
+		}
+	}
+}
+
+BitField<uint8_t> NetworkReactor::Wait(int timeoutMs)
+{
+	BitField<uint8_t> readyEvents{ 0 };
+
+	epoll_event events[4];
+	int numEvents = epoll_wait(m_EpollHandle, events, 4, timeoutMs);
+
+	for (int iteration{ 0 }; iteration < numEvents; iteration++)
+	{
+		uint8_t flag = (uint8_t)events[iteration].data.u32;
+
+		// Consume the counters so the handles are re-armed (level triggered)
+		if (flag == ReactorEvent::QueueWakeup || flag == ReactorEvent::TimerTick)
+		{
+			uint64_t counter;
+			if (read(flag == ReactorEvent::QueueWakeup ? m_WakeHandle : m_TimerHandle,
+				&counter, sizeof(counter)) != sizeof(counter))
+			{
+				continue;
+			}
+		}
+
+		readyEvents.SetFlag(flag);
+	}
+
+	return readyEvents;
+}
+
+void NetworkReactor::Wake()
+{
+	uint64_t increment{ 1 };
+	[[maybe_unused]] ssize_t result = write(m_WakeHandle, &increment, sizeof(increment));
+}
+
+void NetworkReactor::StartTimer(std::chrono::nanoseconds interval)
+{
+	itimerspec timerSpec{};
+	timerSpec.it_interval.tv_sec = (time_t)(interval.count() / 1'000'000'000);
+	timerSpec.it_interval.tv_nsec = (long)(interval.count() % 1'000'000'000);
+	timerSpec.it_value = timerSpec.it_interval;
+
+	if (timerfd_settime(m_TimerHandle, 0, &timerSpec, nullptr) != 0)
+	{
+		TSLogger::Log("Failed to start the reactor timer: %d\n", errno);
+	}
+}
+
+void NetworkReactor::StopTimer()
+{
+	itimerspec timerSpec{};
+	timerfd_settime(m_TimerHandle, 0, &timerSpec, nullptr);
+}
+
+int NetworkReactor::ReadConsoleKeys(char* keys, int maxKeys)
+{
+	ssize_t bytesRead = read(STDIN_FILENO, keys, maxKeys);
+	if (bytesRead <= 0)
+	{
+		return 0;
+	}
+
+	// Match the windows console key codes (enter is a carriage return)
+	for (ssize_t iteration{ 0 }; iteration < bytesRead; iteration++)
+	{
+		if (keys[iteration] == '\n')
+		{
+			keys[iteration] = 13;
+		}
+	}
+
+	return (int)bytesRead;
+}
+
+#endif
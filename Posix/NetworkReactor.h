@@ -0,0 +1,83 @@
+#pragma once
+#include "PosixImpl.h"
+#include "Socket.h"
+#include "../Util/BitField.h"
+
+#include <chrono>
+#include <cstdint>
+
+//==============================
+// Reactor Event Enum
+//==============================
+// Flag indices for the BitField returned by NetworkReactor::Wait. Multiple
+//		sources may be ready after a single wait.
+enum ReactorEvent : uint8_t
+{
+	SocketReadable = 0,
+	QueueWakeup,
+	TimerTick,
+	ConsoleInput
+};
+
+//==============================
+// Network Reactor Class
+//==============================
+// Single blocking wait point for a network thread. The reactor watches the
+//		socket for incoming datagrams, a wakeup handle that is signaled when events
+//		are submitted from other threads, a periodic timer that drives the
+//		LoopTimer based update, and (optionally) the console input handle.
+//		Linux uses epoll with an eventfd/timerfd, Windows uses WaitForMultipleObjects.
+class NetworkReactor
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	NetworkReactor() = default;
+	~NetworkReactor() = default;
+
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// The socket handle may be any readable handle that signals incoming datagrams
+	//		(such as an io_uring completion handle)
+	bool Init(int socketHandle, bool watchConsoleInput);
+	void Terminate();
+
+	//==============================
+	// Wait/Wake
+	//==============================
+	// Block until at least one source is ready (or timeoutMs elapses, -1 is infinite)
+	BitField<uint8_t> Wait(int timeoutMs = -1);
+	// Thread-safe wakeup of a thread blocked in Wait()
+	void Wake();
+
+	//==============================
+	// Manage Timer
+	//==============================
+	void StartTimer(std::chrono::nanoseconds interval);
+	void StopTimer();
+
+	//==============================
+	// Console Input
+	//==============================
+	// Read pending key presses into keys. Returns the number of keys read.
+	int ReadConsoleKeys(char* keys, int maxKeys);
+
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	int m_SocketHandle{ -1 };
+	bool m_WatchConsoleInput{ false };
+#if PLATFORM == PLATFORM_WINDOWS
+	HANDLE m_NetworkEvent{ nullptr };
+	HANDLE m_WakeEvent{ nullptr };
+	HANDLE m_TimerHandle{ nullptr };
+	HANDLE m_ConsoleHandle{ nullptr };
+#else
+	int m_EpollHandle{ -1 };
+	int m_WakeHandle{ -1 };
+	int m_TimerHandle{ -1 };
+#endif
+};
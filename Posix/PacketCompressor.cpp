@@ -0,0 +1,220 @@
+#include "PacketCompressor.h"
+
+#include "../Util/Base.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr int k_MinMatchLength{ 4 };
+static constexpr int k_MaxMatchLength{ k_MinMatchLength + 127 };
+static constexpr int k_MaxLiteralRun{ 128 };
+static constexpr uint8_t k_MatchTokenFlag{ 0x80 };
+static constexpr int k_DictionaryHashBits{ 14 };
+static constexpr int k_PacketHashBits{ 10 };
+
+static uint32_t HashSequence(const uint8_t* location, int hashBits)
+{
+	uint32_t sequence = ((uint32_t)location[0] << 24) | ((uint32_t)location[1] << 16) |
+		((uint32_t)location[2] << 8) | location[3];
+	return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+static int GetMatchLength(const uint8_t* first, const uint8_t* second, int maxLength)
+{
+	int length{ 0 };
+	while (length < maxLength && first[length] == second[length])
+	{
+		length++;
+	}
+	return length;
+}
+
+void PacketCompressor::Init(const std::vector<uint8_t>& dictionary)
+{
+	// Keep the end of oversized dictionaries, which trainers fill with the most common content
+	size_t dictionarySize = std::min(dictionary.size(), k_MaxCompressionDictionarySize);
+	m_Dictionary.assign(dictionary.end() - dictionarySize, dictionary.end());
+
+	// FNV-1a
+	m_DictionaryID = 2166136261u;
+	for (uint8_t value : m_Dictionary)
+	{
+		m_DictionaryID = (m_DictionaryID ^ value) * 16777619u;
+	}
+
+	// Later positions overwrite earlier ones, so matches prefer the closest (cheapest) distance
+	m_DictionaryTable.assign((size_t)1 << k_DictionaryHashBits, -1);
+	for (int position{ 0 }; position + k_MinMatchLength <= (int)m_Dictionary.size(); position++)
+	{
+		m_DictionaryTable[HashSequence(&m_Dictionary[position], k_DictionaryHashBits)] = position;
+	}
+}
+
+int PacketCompressor::CompressPacket(uint8_t* packet, int size)
+{
+	int payloadSize = size - (int)k_PacketHeaderSize;
+	if (payloadSize < k_MinCompressedPayloadSize)
+	{
+		return size;
+	}
+
+	// Only keep the compressed payload if it is smaller
+	int compressedSize = Compress(&packet[k_PacketHeaderSize], payloadSize, m_CompressedPayload.data(), payloadSize - 1);
+	if (compressedSize == 0)
+	{
+		return size;
+	}
+
+	memcpy(&packet[k_PacketHeaderSize], m_CompressedPayload.data(), compressedSize);
+	packet[sizeof(AppID)] |= k_CompressedPacketFlag;
+	return (int)k_PacketHeaderSize + compressedSize;
+}
+
+int PacketCompressor::DecompressPacket(const uint8_t* packet, int size, uint8_t* output) const
+{
+	if (size < (int)k_PacketHeaderSize)
+	{
+		return 0;
+	}
+
+	memcpy(output, packet, k_PacketHeaderSize);
+	output[sizeof(AppID)] &= (uint8_t)~k_CompressedPacketFlag;
+
+	int payloadSize = Decompress(&packet[k_PacketHeaderSize], size - (int)k_PacketHeaderSize,
+		&output[k_PacketHeaderSize], (int)(k_MaxPacketSize - k_PacketHeaderSize));
+	return payloadSize > 0 ? (int)k_PacketHeaderSize + payloadSize : 0;
+}
+
+uint32_t PacketCompressor::GetDictionaryID() const
+{
+	return m_DictionaryID;
+}
+
+int PacketCompressor::Compress(const uint8_t* input, int size, uint8_t* output, int capacity)
+{
+	KG_ASSERT(size <= (int)k_MaxPacketSize);
+
+	m_PacketTable.fill(-1);
+	int dictionarySize = (int)m_Dictionary.size();
+	int outputSize{ 0 };
+	int literalStart{ 0 };
+	int position{ 0 };
+
+	// Write the pending literals as runs of up to k_MaxLiteralRun bytes
+	auto flushLiterals = [&](int end)
+	{
+		while (literalStart < end)
+		{
+			int runLength = std::min(end - literalStart, k_MaxLiteralRun);
+			if (outputSize + 1 + runLength > capacity)
+			{
+				return false;
+			}
+			output[outputSize++] = (uint8_t)(runLength - 1);
+			memcpy(&output[outputSize], &input[literalStart], runLength);
+			outputSize += runLength;
+			literalStart += runLength;
+		}
+		return true;
+	};
+
+	while (position + k_MinMatchLength <= size)
+	{
+		int maxLength = std::min(size - position, k_MaxMatchLength);
+		int bestLength{ 0 };
+		int bestDistance{ 0 };
+
+		// Earlier in the payload
+		uint32_t packetHash = HashSequence(&input[position], k_PacketHashBits);
+		int candidate = m_PacketTable[packetHash];
+		m_PacketTable[packetHash] = (int16_t)position;
+		if (candidate >= 0)
+		{
+			bestLength = GetMatchLength(&input[candidate], &input[position], maxLength);
+			bestDistance = position - candidate;
+		}
+
+		// In the dictionary (matches end at the end of the dictionary)
+		if (dictionarySize > 0)
+		{
+			candidate = m_DictionaryTable[HashSequence(&input[position], k_DictionaryHashBits)];
+			if (candidate >= 0)
+			{
+				int length = GetMatchLength(&m_Dictionary[candidate], &input[position], std::min(maxLength, dictionarySize - candidate));
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = dictionarySize - candidate + position;
+				}
+			}
+		}
+
+		if (bestLength < k_MinMatchLength)
+		{
+			position++;
+			continue;
+		}
+
+		if (!flushLiterals(position) || outputSize + 3 > capacity)
+		{
+			return 0;
+		}
+		output[outputSize++] = (uint8_t)(k_MatchTokenFlag | (bestLength - k_MinMatchLength));
+		WriteUInt16(&output[outputSize], (uint16_t)bestDistance);
+		outputSize += sizeof(uint16_t);
+
+		position += bestLength;
+		literalStart = position;
+	}
+
+	if (!flushLiterals(size))
+	{
+		return 0;
+	}
+	return outputSize;
+}
+
+int PacketCompressor::Decompress(const uint8_t* input, int size, uint8_t* output, int capacity) const
+{
+	int dictionarySize = (int)m_Dictionary.size();
+	int outputSize{ 0 };
+	int offset{ 0 };
+
+	while (offset < size)
+	{
+		uint8_t token = input[offset++];
+		if (!(token & k_MatchTokenFlag))
+		{
+			int runLength = token + 1;
+			if (offset + runLength > size || outputSize + runLength > capacity)
+			{
+				return 0;
+			}
+			memcpy(&output[outputSize], &input[offset], runLength);
+			offset += runLength;
+			outputSize += runLength;
+			continue;
+		}
+
+		if (offset + (int)sizeof(uint16_t) > size)
+		{
+			return 0;
+		}
+		int length = (token & ~k_MatchTokenFlag) + k_MinMatchLength;
+		int distance = ReadUInt16(&input[offset]);
+		offset += sizeof(uint16_t);
+		if (distance == 0 || distance > outputSize + dictionarySize || outputSize + length > capacity)
+		{
+			return 0;
+		}
+
+		// Copy byte by byte, matches may overlap their own output or start in the dictionary
+		for (int index{ 0 }; index < length; index++)
+		{
+			int source = outputSize - distance;
+			output[outputSize++] = source >= 0 ? output[source] : m_Dictionary[dictionarySize + source];
+		}
+	}
+
+	return outputSize;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../Network/NetworkCommon.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Matches may reach this far back into the dictionary, so larger dictionaries are truncated to
+//		their most recent (last) bytes
+constexpr size_t k_MaxCompressionDictionarySize{ 32 * 1024 };
+// Packet payloads shorter than this are sent uncompressed
+constexpr int k_MinCompressedPayloadSize{ 16 };
+
+//==============================
+// Packet Compressor Class
+//==============================
+// LZ77 style compression of the payload (all message records) of sequenced packets. A dictionary
+//		trained offline on captured traffic and shared by both ends acts as a preset window, so
+//		matches are found even in small packets. The payload is a list of tokens, literal runs
+//		(0|length - 1 in 7 bits, bytes) and matches (1|length - k_MinMatchLength in 7 bits,
+//		distance u16) that copy bytes from earlier in the payload or from the dictionary.
+//		Compressed packets set k_CompressedPacketFlag in their packet type byte, packets that
+//		compression would not shrink are sent as they are.
+class PacketCompressor
+{
+public:
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Use the provided dictionary (may be empty) and index it for match searches
+	void Init(const std::vector<uint8_t>& dictionary);
+
+	//==============================
+	// Compress Packets
+	//==============================
+	// Compress the payload of the packet in place if that makes it smaller. Returns the packet's size.
+	int CompressPacket(uint8_t* packet, int size);
+	// Write the decompressed packet (header flag cleared) to the output, which holds k_MaxPacketSize
+	//		bytes. Returns the decompressed size, or 0 if the packet is malformed.
+	int DecompressPacket(const uint8_t* packet, int size, uint8_t* output) const;
+
+	//==============================
+	// Getters/Setters
+	//==============================
+	// Hash of the dictionary, both ends must use the same one
+	uint32_t GetDictionaryID() const;
+private:
+	// Returns the compressed size, or 0 if it would exceed the capacity
+	int Compress(const uint8_t* input, int size, uint8_t* output, int capacity);
+	// Returns the decompressed size, or 0 if the input is malformed
+	int Decompress(const uint8_t* input, int size, uint8_t* output, int capacity) const;
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	std::vector<uint8_t> m_Dictionary{};
+	uint32_t m_DictionaryID{ 0 };
+	// Most recent position of each hashed 4 byte sequence (-1 if none), the dictionary's table is
+	//		built once and the packet's table is cleared for every packet
+	std::vector<int32_t> m_DictionaryTable{};
+	std::array<int16_t, 1024> m_PacketTable{};
+	std::array<uint8_t, k_MaxPacketSize> m_CompressedPayload{};
+};
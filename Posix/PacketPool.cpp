@@ -0,0 +1,223 @@
+#include "PacketPool.h"
+#include "../Util/Base.h"
+
+//==============================
+// Packet Handle
+//==============================
+
+PacketHandle::PacketHandle(PacketPool* pool, uint32_t blockIndex) : m_Pool(pool), m_BlockIndex(blockIndex)
+{
+}
+
+PacketHandle::PacketHandle(const PacketHandle& other) : m_Pool(other.m_Pool), m_BlockIndex(other.m_BlockIndex),
+	m_PayloadOffset(other.m_PayloadOffset), m_PayloadSize(other.m_PayloadSize)
+{
+	if (m_Pool)
+	{
+		m_Pool->AddReference(m_BlockIndex);
+	}
+}
+
+PacketHandle::PacketHandle(PacketHandle&& other) noexcept : m_Pool(other.m_Pool), m_BlockIndex(other.m_BlockIndex),
+	m_PayloadOffset(other.m_PayloadOffset), m_PayloadSize(other.m_PayloadSize)
+{
+	other.m_Pool = nullptr;
+}
+
+PacketHandle::~PacketHandle()
+{
+	Reset();
+}
+
+PacketHandle& PacketHandle::operator=(const PacketHandle& other)
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+
+	// Take the new reference before dropping the old one
+	if (other.m_Pool)
+	{
+		other.m_Pool->AddReference(other.m_BlockIndex);
+	}
+	Reset();
+	m_Pool = other.m_Pool;
+	m_BlockIndex = other.m_BlockIndex;
+	m_PayloadOffset = other.m_PayloadOffset;
+	m_PayloadSize = other.m_PayloadSize;
+	return *this;
+}
+
+PacketHandle& PacketHandle::operator=(PacketHandle&& other) noexcept
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+
+	Reset();
+	m_Pool = other.m_Pool;
+	m_BlockIndex = other.m_BlockIndex;
+	m_PayloadOffset = other.m_PayloadOffset;
+	m_PayloadSize = other.m_PayloadSize;
+	other.m_Pool = nullptr;
+	return *this;
+}
+
+PacketHandle::operator bool() const
+{
+	return IsValid();
+}
+
+void PacketHandle::Reset()
+{
+	if (m_Pool)
+	{
+		m_Pool->ReleaseReference(m_BlockIndex);
+		m_Pool = nullptr;
+	}
+}
+
+bool PacketHandle::IsValid() const
+{
+	return m_Pool != nullptr;
+}
+
+bool PacketHandle::IsShared() const
+{
+	return m_Pool && m_Pool->m_Blocks[m_BlockIndex].m_RefCount.load(std::memory_order_acquire) > 1;
+}
+
+uint8_t* PacketHandle::GetBuffer() const
+{
+	KG_ASSERT(m_Pool);
+	return &m_Pool->m_Buffers[(size_t)m_BlockIndex * m_Pool->m_BlockSize];
+}
+
+void PacketHandle::SetContents(const Address& sender, int size)
+{
+	KG_ASSERT(m_Pool);
+	KG_ASSERT(size >= 0 && size <= (int)m_Pool->m_BlockSize);
+
+	PacketPool::PacketBlock& block = m_Pool->m_Blocks[m_BlockIndex];
+	block.m_Sender = sender;
+	block.m_Size = size;
+}
+
+const Address& PacketHandle::GetSender() const
+{
+	KG_ASSERT(m_Pool);
+	return m_Pool->m_Blocks[m_BlockIndex].m_Sender;
+}
+
+int PacketHandle::GetSize() const
+{
+	KG_ASSERT(m_Pool);
+	return m_Pool->m_Blocks[m_BlockIndex].m_Size;
+}
+
+const uint8_t* PacketHandle::GetPayload() const
+{
+	return GetBuffer() + m_PayloadOffset;
+}
+
+int PacketHandle::GetPayloadSize() const
+{
+	if (m_PayloadSize >= 0)
+	{
+		return m_PayloadSize;
+	}
+
+	int size = GetSize() - m_PayloadOffset;
+	return size > 0 ? size : 0;
+}
+
+void PacketHandle::SetPayload(int offset, int size)
+{
+	KG_ASSERT(m_Pool);
+	KG_ASSERT(offset >= 0 && size >= 0 && offset + size <= (int)m_Pool->m_BlockSize);
+
+	m_PayloadOffset = offset;
+	m_PayloadSize = size;
+}
+
+//==============================
+// Packet Pool
+//==============================
+
+void PacketPool::Init(uint32_t capacity, uint32_t blockSize)
+{
+	KG_ASSERT(capacity > 0);
+	KG_ASSERT(blockSize >= k_MaxPacketSize);
+
+	m_Capacity = capacity;
+	m_BlockSize = blockSize;
+	m_Blocks = std::make_unique<PacketBlock[]>(capacity);
+	m_Buffers = std::make_unique<uint8_t[]>((size_t)capacity * blockSize);
+
+	// Hand out the lowest blocks first
+	std::scoped_lock<std::mutex> lock(m_FreeBlocksMutex);
+	m_FreeBlocks.clear();
+	m_FreeBlocks.reserve(capacity);
+	for (uint32_t blockIndex{ capacity }; blockIndex > 0; blockIndex--)
+	{
+		m_FreeBlocks.push_back(blockIndex - 1);
+	}
+}
+
+PacketHandle PacketPool::Acquire()
+{
+	uint32_t blockIndex;
+
+	{
+		// Obtain the free list lock
+		std::scoped_lock<std::mutex> lock(m_FreeBlocksMutex);
+
+		if (m_FreeBlocks.empty())
+		{
+			return {};
+		}
+
+		blockIndex = m_FreeBlocks.back();
+		m_FreeBlocks.pop_back();
+	}
+
+	PacketBlock& block = m_Blocks[blockIndex];
+	block.m_Size = 0;
+	block.m_RefCount.store(1, std::memory_order_relaxed);
+	return PacketHandle(this, blockIndex);
+}
+
+uint32_t PacketPool::GetCapacity() const
+{
+	return m_Capacity;
+}
+
+uint32_t PacketPool::GetBlockSize() const
+{
+	return m_BlockSize;
+}
+
+uint32_t PacketPool::GetAvailableCount()
+{
+	std::scoped_lock<std::mutex> lock(m_FreeBlocksMutex);
+	return (uint32_t)m_FreeBlocks.size();
+}
+
+void PacketPool::AddReference(uint32_t blockIndex)
+{
+	m_Blocks[blockIndex].m_RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketPool::ReleaseReference(uint32_t blockIndex)
+{
+	// The last reference returns the block (acq_rel so prior reads/writes happen before reuse)
+	if (m_Blocks[blockIndex].m_RefCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	std::scoped_lock<std::mutex> lock(m_FreeBlocksMutex);
+	m_FreeBlocks.push_back(blockIndex);
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "Address.h"
+#include "../Network/NetworkCommon.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+constexpr uint32_t k_DefaultPacketPoolCapacity{ 1024 };
+
+class PacketPool;
+
+//==============================
+// Packet Handle Class
+//==============================
+// Refcounted view into a pooled packet buffer. Copying a handle shares the buffer, and the
+//		buffer returns to its pool once the last handle is released. Each handle may view a
+//		different payload range of the shared buffer. Handles may be held past
+//		the receive call and released from any thread, but not after the pool is destroyed.
+class PacketHandle
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	PacketHandle() = default;
+	PacketHandle(const PacketHandle& other);
+	PacketHandle(PacketHandle&& other) noexcept;
+	~PacketHandle();
+
+	//==============================
+	// Operator Overloads
+	//==============================
+	PacketHandle& operator=(const PacketHandle& other);
+	PacketHandle& operator=(PacketHandle&& other) noexcept;
+	explicit operator bool() const;
+
+	//==============================
+	// Manage Handle
+	//==============================
+	// Drop this handle's reference
+	void Reset();
+	bool IsValid() const;
+	// True if other handles reference the same buffer
+	bool IsShared() const;
+
+	//==============================
+	// Getters/Setters
+	//==============================
+	// Whole block of the pool's block size (used when receiving into the buffer)
+	uint8_t* GetBuffer() const;
+	// Set the sender and number of valid bytes after receiving into the buffer
+	void SetContents(const Address& sender, int size);
+	const Address& GetSender() const;
+	int GetSize() const;
+	// Packet contents following the packet header, or the message the handle was narrowed to
+	const uint8_t* GetPayload() const;
+	int GetPayloadSize() const;
+	// Narrow this handle's payload to a range of the buffer (used to hand over single messages)
+	void SetPayload(int offset, int size);
+private:
+	PacketHandle(PacketPool* pool, uint32_t blockIndex);
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	PacketPool* m_Pool{ nullptr };
+	uint32_t m_BlockIndex{ 0 };
+	// Payload view (a negative size extends to the end of the packet)
+	int m_PayloadOffset{ (int)k_PacketHeaderSize };
+	int m_PayloadSize{ -1 };
+private:
+	friend class PacketPool;
+};
+
+//==============================
+// Packet Pool Class
+//==============================
+// Fixed-capacity slab of equally sized blocks (k_MaxPacketSize unless a larger size is provided,
+//		e.g. for reassembled messages). Blocks are acquired on the network thread and released by
+//		their last handle on any thread.
+class PacketPool
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	PacketPool() = default;
+	~PacketPool() = default;
+
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	void Init(uint32_t capacity = k_DefaultPacketPoolCapacity, uint32_t blockSize = k_MaxPacketSize);
+
+	//==============================
+	// Manage Blocks
+	//==============================
+	// Returns an invalid handle if every block is in use
+	PacketHandle Acquire();
+
+	//==============================
+	// Query Pool
+	//==============================
+	uint32_t GetCapacity() const;
+	uint32_t GetBlockSize() const;
+	uint32_t GetAvailableCount();
+private:
+	// Reference counting (called by PacketHandle)
+	void AddReference(uint32_t blockIndex);
+	void ReleaseReference(uint32_t blockIndex);
+private:
+	//==============================
+	// Internal Structures
+	//==============================
+	struct PacketBlock
+	{
+		Address m_Sender{};
+		int m_Size{ 0 };
+		std::atomic<uint32_t> m_RefCount{ 0 };
+	};
+
+	//==============================
+	// Internal Fields
+	//==============================
+	std::unique_ptr<PacketBlock[]> m_Blocks{ nullptr };
+	// Block buffers are stored back-to-back, block i starts at i * m_BlockSize
+	std::unique_ptr<uint8_t[]> m_Buffers{ nullptr };
+	uint32_t m_Capacity{ 0 };
+	uint32_t m_BlockSize{ k_MaxPacketSize };
+	std::vector<uint32_t> m_FreeBlocks{};
+	std::mutex m_FreeBlocksMutex{};
+private:
+	friend class PacketHandle;
+};
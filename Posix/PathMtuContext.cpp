@@ -0,0 +1,116 @@
+#include "PathMtuContext.h"
+
+#include "../Util/Base.h"
+
+#include <algorithm>
+#include <chrono>
+
+static float GetCurrentTime()
+{
+	using namespace std::chrono;
+	return duration<float>(steady_clock::now().time_since_epoch()).count();
+}
+
+void PathMtuContext::Init(uint16_t maxPacketSize)
+{
+	KG_ASSERT(maxPacketSize >= k_MinPacketSize && maxPacketSize <= k_MaxPacketSize);
+
+	m_PacketSize = (uint16_t)k_MinPacketSize;
+	m_MaxPacketSize = maxPacketSize;
+	m_SearchHigh = maxPacketSize;
+	m_ProbeMaximum = true;
+	m_ProbeSize = 0;
+	m_ProbeAttempts = 0;
+	UpdateSearchRange();
+}
+
+uint16_t PathMtuContext::GetProbeSize(float averageRoundTrip)
+{
+	if (!IsSearching())
+	{
+		return 0;
+	}
+
+	// Wait on the outstanding probe until its timeout passes
+	if (m_ProbeSize != 0)
+	{
+		float probeTimeout = std::max(k_MinProbeTimeout, 3.0f * averageRoundTrip);
+		if (GetCurrentTime() - m_ProbeSendTime < probeTimeout)
+		{
+			return 0;
+		}
+
+		// Rule out the size after repeated losses (a single loss may be unrelated to the size)
+		if (++m_ProbeAttempts >= k_MaxProbeAttempts)
+		{
+			m_SearchHigh = m_ProbeSize - 1;
+			m_ProbeMaximum = false;
+			m_ProbeAttempts = 0;
+			UpdateSearchRange();
+		}
+		m_ProbeSize = 0;
+
+		if (!IsSearching())
+		{
+			return 0;
+		}
+	}
+
+	// Most paths carry the negotiated maximum, so it is tried before searching the range
+	if (m_ProbeMaximum)
+	{
+		return m_SearchHigh;
+	}
+	return (uint16_t)((m_PacketSize + m_SearchHigh + 1) / 2);
+}
+
+void PathMtuContext::OnProbeSent(uint16_t probeSize, uint16_t probeSequence)
+{
+	m_ProbeSize = probeSize;
+	m_ProbeSequence = probeSequence;
+	m_ProbeSendTime = GetCurrentTime();
+}
+
+void PathMtuContext::OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField)
+{
+	if (m_ProbeSize == 0)
+	{
+		return;
+	}
+
+	uint16_t distance = newestSequence - m_ProbeSequence;
+	if (distance >= 32 || !(acknowledgedField & (1u << distance)))
+	{
+		return;
+	}
+
+	// The probe arrived, every later packet may use its size
+	m_PacketSize = m_ProbeSize;
+	m_ProbeSize = 0;
+	m_ProbeAttempts = 0;
+	UpdateSearchRange();
+}
+
+uint16_t PathMtuContext::GetPacketSize() const
+{
+	return m_PacketSize;
+}
+
+uint16_t PathMtuContext::GetMaxPacketSize() const
+{
+	return m_MaxPacketSize;
+}
+
+bool PathMtuContext::IsSearching() const
+{
+	return m_SearchHigh > m_PacketSize;
+}
+
+void PathMtuContext::UpdateSearchRange()
+{
+	// The negotiated maximum is always probed, the search below it ends within the granularity
+	if (!m_ProbeMaximum && m_SearchHigh < m_PacketSize + k_ProbeSearchGranularity)
+	{
+		m_SearchHigh = m_PacketSize;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../Network/NetworkCommon.h"
+
+#include <cstdint>
+
+// Probes of one size that may be lost before the size is ruled out
+constexpr uint8_t k_MaxProbeAttempts{ 3 };
+// The search stops once the confirmed size is this close to the largest size not ruled out
+constexpr uint16_t k_ProbeSearchGranularity{ 16 };
+// Time a probe waits on its ack (at least, scaled by the round trip)
+constexpr float k_MinProbeTimeout{ 0.5f };
+
+//==============================
+// Path MTU Context Class
+//==============================
+// Datagram packetization layer path MTU discovery (RFC 8899 style) for one direction of a
+//		connection. Packets start at k_MinPacketSize and grow up to the maximum negotiated in the
+//		handshake. Larger sizes are tried with padded probe packets, which are confirmed by the
+//		regular packet ack bitfield. The first probe tries the negotiated maximum, after which the
+//		search halves the range between the confirmed size and the smallest size that failed.
+class PathMtuContext
+{
+public:
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Start at k_MinPacketSize and search up to maxPacketSize
+	void Init(uint16_t maxPacketSize);
+
+	//==============================
+	// Probe Path
+	//==============================
+	// Returns the datagram size of the probe to send now, or 0 if none is due. An unacknowledged
+	//		probe is counted as lost once its timeout passes.
+	uint16_t GetProbeSize(float averageRoundTrip);
+	void OnProbeSent(uint16_t probeSize, uint16_t probeSequence);
+	// Confirm the outstanding probe if its packet is newly acknowledged (bit i of the field is the
+	//		sent packet newestSequence - i)
+	void OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField);
+
+	//==============================
+	// Getters/Setters
+	//==============================
+	// Largest datagram confirmed to reach the peer
+	uint16_t GetPacketSize() const;
+	// Largest datagram negotiated in the handshake
+	uint16_t GetMaxPacketSize() const;
+	bool IsSearching() const;
+private:
+	// Stop the search once the remaining range is below the granularity
+	void UpdateSearchRange();
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	uint16_t m_PacketSize{ k_MinPacketSize };
+	uint16_t m_MaxPacketSize{ k_MinPacketSize };
+	// Largest size not ruled out by lost probes (equal to m_PacketSize once the search is done)
+	uint16_t m_SearchHigh{ k_MinPacketSize };
+	bool m_ProbeMaximum{ true };
+
+	// Outstanding probe (m_ProbeSize is 0 if none)
+	uint16_t m_ProbeSize{ 0 };
+	uint16_t m_ProbeSequence{ 0 };
+	float m_ProbeSendTime{ 0.0f };
+	uint8_t m_ProbeAttempts{ 0 };
+};
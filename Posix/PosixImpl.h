@@ -25,7 +25,14 @@
 #elif PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
+#if PLATFORM == PLATFORM_UNIX
+#include <linux/filter.h>
+#include <linux/io_uring.h>
+#endif
 #include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
 #endif
 
 // TODO: Link the winsock library in the actual engine plz TODO TODO TODO
@@ -1,6 +1,7 @@
 #include "ReliabilityContext.h"
 
 #include "../Util/Logger.h"
+#include "../Network/NetworkCommon.h"
 
 #include <cmath>
 #include <chrono>
@@ -31,11 +32,10 @@ void ReliabilityContext::OnUpdate(float deltaTime)
 
 void ReliabilityContext::InsertReliabilitySegmentIntoPacket(uint8_t* segmentLocation)
 {
-	// Initialize the locations of the seq, ack, and ack-bitfield
-	uint16_t& sequenceLocation = *(uint16_t*)segmentLocation;
-	uint16_t& ackLocation = *(uint16_t*)(segmentLocation + sizeof(sequenceLocation));
-	uint32_t& bitFieldLocation = *(uint32_t*)(segmentLocation +
-		sizeof(sequenceLocation) + sizeof(ackLocation));
+	// The segment is stored in network byte order and may be unaligned, so it is written byte by byte
+	uint16_t sequenceLocation{ 0 };
+	uint16_t ackLocation{ 0 };
+	uint32_t bitFieldLocation{ 0 };
 
 	//TSLogger::Log("Sent the packet %d. It has the ack %d. It also has the bit field: ", m_LocalSequence, m_RemoteSequence);
 	//std::cout << std::format("{:032b}\n", m_RemoteAckField.GetRawBitfield());
@@ -48,30 +48,35 @@ void ReliabilityContext::InsertReliabilitySegmentIntoPacket(uint8_t* segmentLoca
 
 	// Insert the recent ack's bitfield (appID|sequenceNum|ackNum|[ackBitField]|...)
 	InsertRemoteSequenceBitField(bitFieldLocation);
+
+	WriteUInt16(segmentLocation, sequenceLocation);
+	WriteUInt16(segmentLocation + sizeof(sequenceLocation), ackLocation);
+	WriteUInt32(segmentLocation + sizeof(sequenceLocation) + sizeof(ackLocation), bitFieldLocation);
 }
 
-void ReliabilityContext::ProcessReliabilitySegmentFromPacket(uint8_t* segmentLocation)
+bool ReliabilityContext::ProcessReliabilitySegmentFromPacket(uint8_t* segmentLocation)
 {
-	// Initialize the locations of the seq, ack, and ack-bitfield
-	uint16_t packetSequence = *(uint16_t*)segmentLocation;
-	uint16_t packetAck = *(uint16_t*)(segmentLocation + sizeof(packetSequence));
-	uint32_t packetAckBitfield = *(uint32_t*)(segmentLocation +
+	// Read the seq, ack, and ack-bitfield (network byte order)
+	uint16_t packetSequence = ReadUInt16(segmentLocation);
+	uint16_t packetAck = ReadUInt16(segmentLocation + sizeof(packetSequence));
+	uint32_t packetAckBitfield = ReadUInt32(segmentLocation +
 		sizeof(packetSequence) + sizeof(packetAck));
 
 	// Update the remote data based on the received sequence number
 	if (!ProcessReceivedSequenceNumber(packetSequence))
 	{
-		return;
+		return false;
 	}
 
 	// Check the ack context
 	if (!ProcessReceivedAck(packetAck, packetAckBitfield))
 	{
-		return;
+		return false;
 	}
 
 	// Packet received successfully
 	m_LastPacketReceived = 0.0f;
+	return true;
 }
 
 void ReliabilityContext::InsertLocalSequenceNumber(uint16_t& sequenceLocation)
@@ -111,22 +116,21 @@ void ReliabilityContext::InsertRemoteSequenceBitField(uint32_t& bitFieldLocation
 
 bool ReliabilityContext::ProcessReceivedSequenceNumber(uint16_t receivedSequenceNumber)
 {
-	uint16_t distance = std::abs((int16_t)receivedSequenceNumber - (int16_t)m_RemoteSequence);
-	bool excessiveDistance = distance > 31;
-
 	// Check if the current sequence number is newer
 	if (SequenceGreaterThan(receivedSequenceNumber, m_RemoteSequence))
 	{
 		// The received packet is 'newer' than the current sequence number's packet
+		uint16_t distance = receivedSequenceNumber - m_RemoteSequence;
 
 		// Clear the bit set if we are shifting too much
-		if (excessiveDistance)
+		if (distance > 31)
 		{
 			m_RemoteAckField.ClearAllFlags();
-			return true;
 		}
-
-		m_RemoteAckField.SetRawBitfield(m_RemoteAckField.GetRawBitfield() << (distance));
+		else
+		{
+			m_RemoteAckField.SetRawBitfield(m_RemoteAckField.GetRawBitfield() << (distance));
+		}
 		m_RemoteAckField.SetFlag(0);
 
 
@@ -137,9 +141,10 @@ bool ReliabilityContext::ProcessReceivedSequenceNumber(uint16_t receivedSequence
 	{
 
 		// The received packet is 'older' than the current sequence number's packet
+		uint16_t distance = m_RemoteSequence - receivedSequenceNumber;
 
 		// Early out if we are shifting too much or packet is already ack'd
-		if (excessiveDistance || m_RemoteAckField.IsFlagSet((uint8_t)distance))
+		if (distance > 31 || m_RemoteAckField.IsFlagSet((uint8_t)distance))
 		{
 			return false;
 		}
@@ -153,26 +158,31 @@ bool ReliabilityContext::ProcessReceivedSequenceNumber(uint16_t receivedSequence
 
 bool ReliabilityContext::ProcessReceivedAck(uint16_t ackNumber, uint32_t ackBitField)
 {
-	uint16_t distance = std::abs((int16_t)m_LocalSequence - (int16_t)ackNumber);
-	bool excessiveDistance = distance > 32;
+	m_NewlyAcknowledgedField = 0;
 
 	// The ack number should never be greater than the local sequence value
 	// (If so, likely a corrupted packet or a bad actor)
 	if (SequenceGreaterThan(ackNumber, m_LocalSequence) ||
-		ackNumber == m_LocalSequence ||
-		excessiveDistance)
+		ackNumber == m_LocalSequence)
 	{
 		return false;
 	}
 
+	// Acks older than the local bitfield carry no new information
+	uint16_t distance = m_LocalSequence - ackNumber;
+	if (distance > 32)
+	{
+		return true;
+	}
+
 	// Modify the received bit field to align with the local bitfield
 	ackBitField = (ackBitField << (distance - 1));
 
 	// Use logical implication to reveal modified packets
 	uint32_t newlyAcknowledgedField = (~m_LocalAckField.GetRawBitfield()) & ackBitField;
 
-	// Scan the newly-acknowledged-field and acknowledge the packets
-	// TODO: Add meaningful acknowledgement method here
+	// Scan the newly-acknowledged-field and update the round trip (the reliable channel reads the
+	//		field afterwards to acknowledge the messages the packets carried)
 	for (uint16_t iteration{ 0 }; iteration < 32; iteration++)
 	{
 		// Check this specific bit
@@ -189,8 +199,28 @@ bool ReliabilityContext::ProcessReceivedAck(uint16_t ackNumber, uint32_t ackBitF
 
 	// Finally, update the local bitfield with new acknowledgements
 	m_LocalAckField.SetRawBitfield(m_LocalAckField.GetRawBitfield() | ackBitField);
+	m_NewlyAcknowledgedField = newlyAcknowledgedField;
+
+	return true;
+}
+
+uint16_t ReliabilityContext::GetNewestSentSequence() const
+{
+	return m_LocalSequence - 1;
+}
+
+uint32_t ReliabilityContext::GetNewlyAcknowledgedField() const
+{
+	return m_NewlyAcknowledgedField;
+}
+
+float ReliabilityContext::GetResendDelay()
+{
+	constexpr float k_MinResendDelay{ 0.1f };
+	constexpr float k_RoundTripFactor{ 1.5f };
 
-	return newlyAcknowledgedField;
+	float resendDelay = m_RoundTripContext.GetAverageRoundTrip() * k_RoundTripFactor;
+	return resendDelay > k_MinResendDelay ? resendDelay : k_MinResendDelay;
 }
 
 void ReliabilityContext::ProcessRoundTrip(float packetRoundTrip)
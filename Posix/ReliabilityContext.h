@@ -83,7 +83,18 @@ public:
 	// Interact with Packet
 	//==============================
 	void InsertReliabilitySegmentIntoPacket(uint8_t* segmentLocation);
-	void ProcessReliabilitySegmentFromPacket(uint8_t* segmentLocation);
+	// Returns true if the packet was accepted (new sequence and valid ack)
+	bool ProcessReliabilitySegmentFromPacket(uint8_t* segmentLocation);
+
+	//==============================
+	// Query Acknowledgements
+	//==============================
+	// Bit i of the newly acknowledged field (from the last processed packet) is the sent packet
+	//		GetNewestSentSequence() - i
+	uint16_t GetNewestSentSequence() const;
+	uint32_t GetNewlyAcknowledgedField() const;
+	// Time to wait for an ack before resending reliable messages (derived from the round trip)
+	float GetResendDelay();
 
 private:
 	// Insert-segment helpers
@@ -117,5 +128,6 @@ private:
 	uint16_t m_RemoteSequence{ 0 };
 	BitField<uint32_t> m_LocalAckField{ 0b1111'1111'1111'1111'1111'1111'1111'1111 };
 	BitField<uint32_t> m_RemoteAckField{ 0b1111'1111'1111'1111'1111'1111'1111'1110 };
+	uint32_t m_NewlyAcknowledgedField{ 0 };
 
 };
\ No newline at end of file
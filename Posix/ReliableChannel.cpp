@@ -0,0 +1,428 @@
+#include "ReliableChannel.h"
+
+#include "../Util/Base.h"
+#include "../Util/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static float GetCurrentTime()
+{
+	using namespace std::chrono;
+	return duration<float>(steady_clock::now().time_since_epoch()).count();
+}
+
+void ReliableChannel::Init(ChannelType channel, uint16_t windowSize)
+{
+	KG_ASSERT(channel == ChannelType::Reliable || channel == ChannelType::ReliableOrdered);
+	KG_ASSERT(windowSize > 0 && windowSize <= k_MaxReliableWindowSize && (windowSize & (windowSize - 1)) == 0);
+
+	// Buffers are reallocated on first use if the configuration changed
+	if (channel != m_Channel || windowSize != m_WindowSize)
+	{
+		m_Channel = channel;
+		m_WindowSize = windowSize;
+		m_SendBuffer.clear();
+		m_ReceivedMessages.clear();
+		m_ReorderBuffer.clear();
+	}
+
+	Reset();
+}
+
+void ReliableChannel::Reset()
+{
+	for (PendingMessage& message : m_SendBuffer)
+	{
+		message.m_Acknowledged = true;
+	}
+	m_NextMessageID = 0;
+	m_OldestUnacknowledged = 0;
+	m_SentPackets.fill(SentPacket());
+	m_SendFragments = FragmentedMessage();
+	m_ReceiveBase = 0;
+	std::fill(m_ReceivedMessages.begin(), m_ReceivedMessages.end(), (uint8_t)false);
+
+	// Return the blocks of held messages to their pools
+	for (PacketHandle& bufferedMessage : m_ReorderBuffer)
+	{
+		bufferedMessage.Reset();
+	}
+	m_Reassembly.m_Active = false;
+	m_Reassembly.m_Block.Reset();
+}
+
+bool ReliableChannel::QueueMessage(const void* data, int size, uint16_t& messageID)
+{
+	bool fragmented = size > (int)k_MaxSequencedMessageSize;
+	if (size < 0 || size > (int)k_MaxFragmentedMessageSize || (fragmented && m_SendFragments.m_Active))
+	{
+		return false;
+	}
+
+	// The receiver only tracks a window of message IDs past its oldest missing message
+	if ((uint16_t)(m_NextMessageID - m_OldestUnacknowledged) >= m_WindowSize)
+	{
+		return false;
+	}
+
+	if (m_SendBuffer.empty())
+	{
+		m_SendBuffer.resize(m_WindowSize);
+	}
+
+	// Store the message until it is acknowledged
+	messageID = m_NextMessageID++;
+	PendingMessage& message = m_SendBuffer[messageID & (m_WindowSize - 1)];
+	message.m_MessageID = messageID;
+	message.m_Acknowledged = false;
+	message.m_Fragmented = fragmented;
+	message.m_LastSendTime = -1.0f;
+
+	// Fragmented messages are copied whole and split when written
+	if (fragmented)
+	{
+		FragmentedMessage& fragmentedMessage = m_SendFragments;
+		fragmentedMessage.m_Active = true;
+		fragmentedMessage.m_MessageID = messageID;
+		fragmentedMessage.m_FragmentCount = (uint16_t)((size + k_FragmentSize - 1) / k_FragmentSize);
+		fragmentedMessage.m_NumAcknowledged = 0;
+		fragmentedMessage.m_Data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+		fragmentedMessage.m_AcknowledgedFragments.assign(fragmentedMessage.m_FragmentCount, (uint8_t)false);
+		fragmentedMessage.m_LastSendTimes.assign(fragmentedMessage.m_FragmentCount, -1.0f);
+		message.m_Size = 0;
+		return true;
+	}
+
+	message.m_Size = (uint16_t)size;
+	if (size > 0)
+	{
+		memcpy(message.m_Data.data(), data, size);
+	}
+	return true;
+}
+
+int ReliableChannel::WriteMessages(uint16_t packetSequence, uint8_t* buffer, int capacity, int budget, float resendDelay)
+{
+	// Claim the ring entry for this packet, replacing a packet that was never acknowledged
+	SentPacket& sentPacket = m_SentPackets[packetSequence % k_SentPacketRingSize];
+	sentPacket.m_Sequence = packetSequence;
+	sentPacket.m_NumMessages = 0;
+
+	if (!HasUnacknowledgedMessages())
+	{
+		return 0;
+	}
+
+	float currentTime = GetCurrentTime();
+	int bytesWritten{ 0 };
+
+	for (uint16_t messageID{ m_OldestUnacknowledged }; messageID != m_NextMessageID; messageID++)
+	{
+		if (sentPacket.m_NumMessages >= k_MaxReliableMessagesPerPacket)
+		{
+			break;
+		}
+
+		PendingMessage& message = m_SendBuffer[messageID & (m_WindowSize - 1)];
+		if (!message.m_Acknowledged && message.m_Fragmented)
+		{
+			bytesWritten = WriteFragments(sentPacket, buffer, bytesWritten, capacity, budget, currentTime, resendDelay);
+			continue;
+		}
+
+		// Skip acknowledged messages and messages still waiting on an ack
+		if (message.m_Acknowledged ||
+			(message.m_LastSendTime >= 0.0f && currentTime - message.m_LastSendTime < resendDelay))
+		{
+			continue;
+		}
+
+		// Smaller messages later in the window may still fit. The first record ignores the budget
+		//		so budgets smaller than a message cannot stall the channel.
+		int recordSize = (int)k_SequencedRecordHeaderSize + message.m_Size;
+		if (bytesWritten + recordSize > capacity || (bytesWritten > 0 && bytesWritten + recordSize > budget))
+		{
+			continue;
+		}
+
+		bytesWritten += WriteMessageRecord(&buffer[bytesWritten], m_Channel, messageID,
+			message.m_Data.data(), message.m_Size);
+		message.m_LastSendTime = currentTime;
+		sentPacket.m_MessageIDs[sentPacket.m_NumMessages] = messageID;
+		sentPacket.m_FragmentIndices[sentPacket.m_NumMessages] = k_NoFragmentIndex;
+		sentPacket.m_NumMessages++;
+	}
+
+	return bytesWritten;
+}
+
+bool ReliableChannel::ReserveReassemblyBlock(const MessageRecord& record, PacketPool& reassemblyPool)
+{
+	// Fragments of received messages and of the reassembly in progress need no new block
+	if (record.m_FragmentCount == 0 || m_Reassembly.m_Block || !IsNewMessage(record.m_MessageID))
+	{
+		return true;
+	}
+
+	KG_ASSERT(reassemblyPool.GetBlockSize() >= k_ReassemblyBlockSize);
+	m_Reassembly.m_Block = reassemblyPool.Acquire();
+	return (bool)m_Reassembly.m_Block;
+}
+
+ChannelType ReliableChannel::GetChannelType() const
+{
+	return m_Channel;
+}
+
+bool ReliableChannel::HasUnacknowledgedMessages() const
+{
+	return m_OldestUnacknowledged != m_NextMessageID;
+}
+
+bool ReliableChannel::HasMessagesToSend(float resendDelay) const
+{
+	float currentTime = GetCurrentTime();
+	auto isDue = [&](float lastSendTime)
+	{
+		return lastSendTime < 0.0f || currentTime - lastSendTime >= resendDelay;
+	};
+
+	for (uint16_t messageID{ m_OldestUnacknowledged }; messageID != m_NextMessageID; messageID++)
+	{
+		const PendingMessage& message = m_SendBuffer[messageID & (m_WindowSize - 1)];
+		if (message.m_Acknowledged)
+		{
+			continue;
+		}
+
+		if (!message.m_Fragmented)
+		{
+			if (isDue(message.m_LastSendTime))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		// Due fragments wait while the packets in flight are at their limit
+		const FragmentedMessage& fragmentedMessage = m_SendFragments;
+		if (FindFreeFragmentPacket(currentTime, resendDelay) < 0)
+		{
+			continue;
+		}
+		for (uint16_t fragmentIndex{ 0 }; fragmentIndex < fragmentedMessage.m_FragmentCount; fragmentIndex++)
+		{
+			if (!fragmentedMessage.m_AcknowledgedFragments[fragmentIndex] && isDue(fragmentedMessage.m_LastSendTimes[fragmentIndex]))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool ReliableChannel::IsSendingFragments() const
+{
+	return m_SendFragments.m_Active;
+}
+
+bool ReliableChannel::IsNewMessage(uint16_t messageID) const
+{
+	if ((uint16_t)(messageID - m_ReceiveBase) >= m_WindowSize)
+	{
+		return false;
+	}
+	return m_ReceivedMessages.empty() || !m_ReceivedMessages[messageID & (m_WindowSize - 1)];
+}
+
+bool ReliableChannel::IsReassembling() const
+{
+	return m_Reassembly.m_Active;
+}
+
+bool ReliableChannel::IsReassemblyStalled(float timeout) const
+{
+	return m_Reassembly.m_Active && GetCurrentTime() - m_Reassembly.m_LastFragmentTime >= timeout;
+}
+
+void ReliableChannel::AdvanceSendWindow()
+{
+	while (m_OldestUnacknowledged != m_NextMessageID &&
+		m_SendBuffer[m_OldestUnacknowledged & (m_WindowSize - 1)].m_Acknowledged)
+	{
+		m_OldestUnacknowledged++;
+	}
+}
+
+void ReliableChannel::AllocateReceiveWindow()
+{
+	if (!m_ReceivedMessages.empty())
+	{
+		return;
+	}
+
+	m_ReceivedMessages.assign(m_WindowSize, (uint8_t)false);
+	if (m_Channel == ChannelType::ReliableOrdered)
+	{
+		m_ReorderBuffer.resize(m_WindowSize);
+	}
+}
+
+int ReliableChannel::WriteFragments(SentPacket& sentPacket, uint8_t* buffer, int bytesWritten, int capacity, int budget,
+	float currentTime, float resendDelay)
+{
+	FragmentedMessage& fragmentedMessage = m_SendFragments;
+	int messageSize = (int)fragmentedMessage.m_Data.size();
+
+	// Wait on acks once enough packets of fragments are in flight
+	int packetInFlight = FindFreeFragmentPacket(currentTime, resendDelay);
+	if (packetInFlight < 0)
+	{
+		return bytesWritten;
+	}
+	int firstFragmentRecord = bytesWritten;
+
+	for (uint16_t fragmentIndex{ 0 }; fragmentIndex < fragmentedMessage.m_FragmentCount; fragmentIndex++)
+	{
+		if (sentPacket.m_NumMessages >= k_MaxReliableMessagesPerPacket)
+		{
+			break;
+		}
+
+		// Skip acknowledged fragments and fragments still waiting on an ack
+		float lastSendTime = fragmentedMessage.m_LastSendTimes[fragmentIndex];
+		if (fragmentedMessage.m_AcknowledgedFragments[fragmentIndex] ||
+			(lastSendTime >= 0.0f && currentTime - lastSendTime < resendDelay))
+		{
+			continue;
+		}
+
+		// Only the last fragment is shorter, it may still fit
+		int fragmentOffset = fragmentIndex * (int)k_FragmentSize;
+		int fragmentSize = std::min((int)k_FragmentSize, messageSize - fragmentOffset);
+		int recordSize = (int)(k_SequencedRecordHeaderSize + k_FragmentHeaderSize) + fragmentSize;
+		if (bytesWritten + recordSize > capacity || (bytesWritten > 0 && bytesWritten + recordSize > budget))
+		{
+			continue;
+		}
+
+		bytesWritten += WriteFragmentRecord(&buffer[bytesWritten], m_Channel, fragmentedMessage.m_MessageID,
+			fragmentIndex, fragmentedMessage.m_FragmentCount, &fragmentedMessage.m_Data[fragmentOffset], fragmentSize);
+		fragmentedMessage.m_LastSendTimes[fragmentIndex] = currentTime;
+		sentPacket.m_MessageIDs[sentPacket.m_NumMessages] = fragmentedMessage.m_MessageID;
+		sentPacket.m_FragmentIndices[sentPacket.m_NumMessages] = fragmentIndex;
+		sentPacket.m_NumMessages++;
+	}
+
+	if (bytesWritten > firstFragmentRecord)
+	{
+		fragmentedMessage.m_PacketsInFlight[packetInFlight] = { sentPacket.m_Sequence, currentTime };
+	}
+	return bytesWritten;
+}
+
+int ReliableChannel::FindFreeFragmentPacket(float currentTime, float resendDelay) const
+{
+	const auto& packetsInFlight = m_SendFragments.m_PacketsInFlight;
+	for (int index{ 0 }; index < (int)packetsInFlight.size(); index++)
+	{
+		// Packets unacknowledged for the resend delay are counted as lost
+		float sendTime = packetsInFlight[index].m_SendTime;
+		if (sendTime < 0.0f || currentTime - sendTime >= resendDelay)
+		{
+			return index;
+		}
+	}
+	return -1;
+}
+
+void ReliableChannel::ReleaseFragmentPacket(uint16_t packetSequence)
+{
+	for (FragmentPacket& packet : m_SendFragments.m_PacketsInFlight)
+	{
+		if (packet.m_SendTime >= 0.0f && packet.m_Sequence == packetSequence)
+		{
+			packet.m_SendTime = -1.0f;
+			return;
+		}
+	}
+}
+
+bool ReliableChannel::AcknowledgeFragment(uint16_t messageID, uint16_t fragmentIndex)
+{
+	FragmentedMessage& fragmentedMessage = m_SendFragments;
+	if (!fragmentedMessage.m_Active || fragmentedMessage.m_MessageID != messageID ||
+		fragmentedMessage.m_AcknowledgedFragments[fragmentIndex])
+	{
+		return false;
+	}
+
+	fragmentedMessage.m_AcknowledgedFragments[fragmentIndex] = true;
+	if (++fragmentedMessage.m_NumAcknowledged < fragmentedMessage.m_FragmentCount)
+	{
+		return false;
+	}
+
+	// Release the message data, the next fragmented message may be queued
+	fragmentedMessage = FragmentedMessage();
+	return true;
+}
+
+bool ReliableChannel::ReceiveFragment(const MessageRecord& record, const Address& sender, PacketHandle& message)
+{
+	// Every fragment except the last carries exactly k_FragmentSize bytes
+	uint16_t fragmentIndex = record.m_FragmentIndex;
+	uint16_t fragmentCount = record.m_FragmentCount;
+	bool lastFragment = fragmentIndex + 1 == fragmentCount;
+	if (fragmentCount < 2 || fragmentCount > k_MaxFragmentsPerMessage || fragmentIndex >= fragmentCount ||
+		(!lastFragment && record.m_Size != (int)k_FragmentSize) || (lastFragment && (record.m_Size <= 0 || record.m_Size > (int)k_FragmentSize)))
+	{
+		return false;
+	}
+
+	// Start the reassembly with the first fragment that arrives, in the block reserved before its
+	//		packet was accepted (only a sender with two fragmented messages in flight has none)
+	Reassembly& reassembly = m_Reassembly;
+	if (!reassembly.m_Active)
+	{
+		if (!reassembly.m_Block)
+		{
+			return false;
+		}
+		reassembly.m_Active = true;
+		reassembly.m_MessageID = record.m_MessageID;
+		reassembly.m_FragmentCount = fragmentCount;
+		reassembly.m_NumReceived = 0;
+		reassembly.m_Size = 0;
+		reassembly.m_ReceivedFragments.assign(fragmentCount, (uint8_t)false);
+	}
+
+	// The sender only starts a fragmented message once the previous one was received
+	if (reassembly.m_MessageID != record.m_MessageID || reassembly.m_FragmentCount != fragmentCount ||
+		reassembly.m_ReceivedFragments[fragmentIndex])
+	{
+		return false;
+	}
+
+	reassembly.m_ReceivedFragments[fragmentIndex] = true;
+	reassembly.m_NumReceived++;
+	reassembly.m_LastFragmentTime = GetCurrentTime();
+	memcpy(reassembly.m_Block.GetBuffer() + k_PacketHeaderSize + fragmentIndex * k_FragmentSize, record.m_Data, record.m_Size);
+	if (lastFragment)
+	{
+		reassembly.m_Size = fragmentIndex * (int)k_FragmentSize + record.m_Size;
+	}
+
+	if (reassembly.m_NumReceived < fragmentCount)
+	{
+		return false;
+	}
+
+	// Hand over the block laid out like a received packet
+	message = std::move(reassembly.m_Block);
+	message.SetContents(sender, (int)k_PacketHeaderSize + reassembly.m_Size);
+	reassembly.m_Active = false;
+	return true;
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "../Network/NetworkCommon.h"
+#include "PacketPool.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Number of message IDs past the oldest unacknowledged message that may be in flight. The window
+//		is a power of two (so it divides the message ID space) and must match on both ends.
+constexpr uint16_t k_DefaultReliableWindowSize{ 64 };
+constexpr uint16_t k_MaxReliableWindowSize{ 4096 };
+// Number of sent packets remembered for acknowledgement (must cover the 33 packet ack window)
+constexpr uint16_t k_SentPacketRingSize{ 64 };
+constexpr int k_MaxReliableMessagesPerPacket{ 16 };
+// Packets carrying fragments that may be unacknowledged at once. Stays within the 33 packet ack
+//		window, so the acks of the fragments that arrived are not lost to a burst of later packets.
+constexpr uint16_t k_MaxFragmentPacketsInFlight{ 32 };
+// Fragment index of sent packet entries that carried a whole message
+constexpr uint16_t k_NoFragmentIndex{ UINT16_MAX };
+// Block size of reassembly pools (reassembled messages are laid out like a received packet)
+constexpr uint32_t k_ReassemblyBlockSize{ (uint32_t)(k_PacketHeaderSize + k_MaxFragmentsPerMessage * k_FragmentSize) };
+
+//==============================
+// Reliable Channel Class
+//==============================
+// Reliable messages for one connection, built on the packet sequence/ack scheme of
+//		ReliabilityContext. Queued messages are written as records into the following sequenced
+//		packets, and the message IDs each packet carried are kept in a ring keyed by the packet's
+//		sequence number. Once the packet is acknowledged its messages are delivered, otherwise
+//		they are written again into a later packet after the resend delay.
+//		Ordered channels hold messages that arrive early in a reorder buffer and release them once
+//		the messages before them arrive. Each channel has its own message IDs, so a missing
+//		message only delays the messages of its own channel.
+//		Messages larger than a packet take one message ID and are sent as fragment records, which
+//		are acknowledged individually so only the missing fragments are resent. At most
+//		k_MaxFragmentPacketsInFlight packets with fragments wait on their ack, the remaining
+//		fragments are sent as acks arrive (or the resend delay passes). One fragmented message is
+//		in flight per channel and direction, and the receiver reassembles it into a block of the
+//		reassembly pool. The block is reserved before the packet of the first fragment is
+//		acknowledged, packets arriving while the pool is exhausted are dropped unacknowledged so
+//		the sender resends them. Received messages are never dropped, a reassembly that stalls
+//		closes the connection instead.
+class ReliableChannel
+{
+public:
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Set the channel type (Reliable or ReliableOrdered) and window, and drop all state
+	void Init(ChannelType channel, uint16_t windowSize = k_DefaultReliableWindowSize);
+	// Drop all sent and received state (buffers are kept allocated)
+	void Reset();
+
+	//==============================
+	// Send Messages
+	//==============================
+	// Returns false if the message is too large, the send window is full, or the message needs
+	//		fragmenting while another fragmented message is in flight
+	bool QueueMessage(const void* data, int size, uint16_t& messageID);
+	// Write the messages and fragments that were never sent or are due for resending as records,
+	//		and remember them for the packet's sequence number. Records past the first stop at the
+	//		budget. Returns the number of bytes written.
+	int WriteMessages(uint16_t packetSequence, uint8_t* buffer, int capacity, int budget, float resendDelay);
+	// Mark the messages carried by newly acknowledged packets as delivered. Bit i of the field is
+	//		the packet newestSequence - i. The handler is called with each delivered message ID.
+	template<typename DeliveredFn>
+	void OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField, DeliveredFn&& onDelivered);
+
+	//==============================
+	// Receive Messages
+	//==============================
+	// Drop duplicates and call the handler (const uint8_t* data, int size, const PacketHandle& message)
+	//		with each message that can be delivered. Whole new messages arrive held in a pooled block
+	//		(message), ordered messages received early keep it in the reorder buffer. Reassembled
+	//		messages are passed with their reassembly pool block.
+	template<typename DeliverFn>
+	void ReceiveMessage(const MessageRecord& record, const Address& sender, PacketHandle message, DeliverFn&& deliver);
+	// Acquire the reassembly block a fragment record needs before its packet is acknowledged.
+	//		Returns false if the reassembly pool is exhausted.
+	bool ReserveReassemblyBlock(const MessageRecord& record, PacketPool& reassemblyPool);
+
+	//==============================
+	// Query Channel
+	//==============================
+	ChannelType GetChannelType() const;
+	bool HasUnacknowledgedMessages() const;
+	// True if a queued message or fragment was never sent or is due for resending
+	bool HasMessagesToSend(float resendDelay) const;
+	// True while a fragmented message waits on acks of its fragments
+	bool IsSendingFragments() const;
+	// True if the message is inside the receive window and was not received yet
+	bool IsNewMessage(uint16_t messageID) const;
+	// True while a fragmented message is being reassembled
+	bool IsReassembling() const;
+	// True if a reassembly received no fragment for the timeout
+	bool IsReassemblyStalled(float timeout) const;
+private:
+	struct SentPacket;
+
+	// Move the send window past acknowledged messages
+	void AdvanceSendWindow();
+	// Allocate the receive window on the first received message
+	void AllocateReceiveWindow();
+	// Write the due fragments of the message in flight after bytesWritten, returns the new bytesWritten
+	int WriteFragments(SentPacket& sentPacket, uint8_t* buffer, int bytesWritten, int capacity, int budget,
+		float currentTime, float resendDelay);
+	// Returns the index of a free fragment packet entry (unused or past the resend delay), or -1
+	//		if k_MaxFragmentPacketsInFlight packets are waiting on their ack
+	int FindFreeFragmentPacket(float currentTime, float resendDelay) const;
+	// Free the fragment packet entry of an acknowledged packet
+	void ReleaseFragmentPacket(uint16_t packetSequence);
+	// Returns true once every fragment of the message in flight is acknowledged
+	bool AcknowledgeFragment(uint16_t messageID, uint16_t fragmentIndex);
+	// Returns true once every fragment of the message arrived, the message is the reassembled block
+	bool ReceiveFragment(const MessageRecord& record, const Address& sender, PacketHandle& message);
+private:
+	//==============================
+	// Internal Structures
+	//==============================
+	struct PendingMessage
+	{
+		uint16_t m_MessageID{ 0 };
+		uint16_t m_Size{ 0 };
+		bool m_Acknowledged{ true };
+		// Fragmented messages keep their data and send state in m_SendFragments
+		bool m_Fragmented{ false };
+		// Negative until the message is first sent
+		float m_LastSendTime{ -1.0f };
+		std::array<uint8_t, k_MaxSequencedMessageSize> m_Data;
+	};
+
+	struct SentPacket
+	{
+		uint16_t m_Sequence{ 0 };
+		uint8_t m_NumMessages{ 0 };
+		std::array<uint16_t, k_MaxReliableMessagesPerPacket> m_MessageIDs;
+		std::array<uint16_t, k_MaxReliableMessagesPerPacket> m_FragmentIndices;
+	};
+
+	struct FragmentPacket
+	{
+		uint16_t m_Sequence{ 0 };
+		// Negative while the entry is free
+		float m_SendTime{ -1.0f };
+	};
+
+	struct FragmentedMessage
+	{
+		bool m_Active{ false };
+		uint16_t m_MessageID{ 0 };
+		uint16_t m_FragmentCount{ 0 };
+		uint16_t m_NumAcknowledged{ 0 };
+		std::vector<uint8_t> m_Data{};
+		std::vector<uint8_t> m_AcknowledgedFragments{};
+		// Negative until the fragment is first sent
+		std::vector<float> m_LastSendTimes{};
+		// Packets with fragments that wait on their ack
+		std::array<FragmentPacket, k_MaxFragmentPacketsInFlight> m_PacketsInFlight{};
+	};
+
+	struct Reassembly
+	{
+		bool m_Active{ false };
+		uint16_t m_MessageID{ 0 };
+		uint16_t m_FragmentCount{ 0 };
+		uint16_t m_NumReceived{ 0 };
+		int m_Size{ 0 };
+		float m_LastFragmentTime{ 0.0f };
+		std::vector<uint8_t> m_ReceivedFragments{};
+		// Reserved before the first fragment's packet is acknowledged
+		PacketHandle m_Block{};
+	};
+
+	//==============================
+	// Internal Fields
+	//==============================
+	ChannelType m_Channel{ ChannelType::Reliable };
+	uint16_t m_WindowSize{ k_DefaultReliableWindowSize };
+
+	// Send window [m_OldestUnacknowledged, m_NextMessageID), allocated on the first queued message
+	std::vector<PendingMessage> m_SendBuffer{};
+	uint16_t m_NextMessageID{ 0 };
+	uint16_t m_OldestUnacknowledged{ 0 };
+	std::array<SentPacket, k_SentPacketRingSize> m_SentPackets{};
+	FragmentedMessage m_SendFragments{};
+
+	// Receive window [m_ReceiveBase, m_ReceiveBase + m_WindowSize), slot (messageID % m_WindowSize) is
+	//		set once the message is received. Ordered channels keep early messages in the reorder buffer.
+	uint16_t m_ReceiveBase{ 0 };
+	std::vector<uint8_t> m_ReceivedMessages{};
+	std::vector<PacketHandle> m_ReorderBuffer{};
+	Reassembly m_Reassembly{};
+};
+
+template<typename DeliveredFn>
+void ReliableChannel::OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField, DeliveredFn&& onDelivered)
+{
+	if (m_SendBuffer.empty())
+	{
+		return;
+	}
+
+	while (acknowledgedField)
+	{
+		uint16_t bit = (uint16_t)std::countr_zero(acknowledgedField);
+		acknowledgedField &= acknowledgedField - 1;
+
+		// Skip packets that carried no messages or were overwritten in the ring
+		uint16_t sequence = newestSequence - bit;
+		SentPacket& sentPacket = m_SentPackets[sequence % k_SentPacketRingSize];
+		if (sentPacket.m_Sequence != sequence)
+		{
+			continue;
+		}
+
+		// Make room for the next packet of fragments
+		if (m_SendFragments.m_Active)
+		{
+			ReleaseFragmentPacket(sequence);
+		}
+
+		for (uint8_t iteration{ 0 }; iteration < sentPacket.m_NumMessages; iteration++)
+		{
+			uint16_t messageID = sentPacket.m_MessageIDs[iteration];
+			PendingMessage& message = m_SendBuffer[messageID & (m_WindowSize - 1)];
+			if (message.m_Acknowledged || message.m_MessageID != messageID)
+			{
+				continue;
+			}
+
+			// Fragmented messages are delivered with their last missing fragment
+			uint16_t fragmentIndex = sentPacket.m_FragmentIndices[iteration];
+			if (fragmentIndex != k_NoFragmentIndex && !AcknowledgeFragment(messageID, fragmentIndex))
+			{
+				continue;
+			}
+
+			message.m_Acknowledged = true;
+			onDelivered(messageID);
+		}
+		sentPacket.m_NumMessages = 0;
+	}
+
+	AdvanceSendWindow();
+}
+
+template<typename DeliverFn>
+void ReliableChannel::ReceiveMessage(const MessageRecord& record, const Address& sender, PacketHandle message, DeliverFn&& deliver)
+{
+	// Messages before the base were already received, and the sender never passes the window
+	uint16_t messageID = record.m_MessageID;
+	bool fragmented = record.m_FragmentCount > 0;
+	if ((uint16_t)(messageID - m_ReceiveBase) >= m_WindowSize || (!fragmented && record.m_Size > (int)k_MaxSequencedMessageSize))
+	{
+		return;
+	}
+
+	AllocateReceiveWindow();
+
+	uint16_t slot = messageID & (m_WindowSize - 1);
+	if (m_ReceivedMessages[slot])
+	{
+		return;
+	}
+
+	// Fragmented messages are received once their last missing fragment arrives
+	if (fragmented && !ReceiveFragment(record, sender, message))
+	{
+		return;
+	}
+	m_ReceivedMessages[slot] = true;
+
+	// Hold ordered messages until the messages before them arrive
+	bool ordered = m_Channel == ChannelType::ReliableOrdered;
+	if (ordered && messageID != m_ReceiveBase)
+	{
+		m_ReorderBuffer[slot] = std::move(message);
+		return;
+	}
+
+	// Unordered messages and the next ordered message are delivered right away
+	deliver(message.GetPayload(), message.GetPayloadSize(), message);
+
+	// Move the base past every received message, releasing the held ordered messages in order
+	slot = m_ReceiveBase & (m_WindowSize - 1);
+	while (m_ReceivedMessages[slot])
+	{
+		if (ordered && m_ReceiveBase != messageID)
+		{
+			PacketHandle& bufferedMessage = m_ReorderBuffer[slot];
+			deliver(bufferedMessage.GetPayload(), bufferedMessage.GetPayloadSize(), bufferedMessage);
+			bufferedMessage.Reset();
+		}
+
+		m_ReceivedMessages[slot] = false;
+		m_ReceiveBase++;
+		slot = m_ReceiveBase & (m_WindowSize - 1);
+	}
+}
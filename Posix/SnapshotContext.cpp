@@ -0,0 +1,273 @@
+#include "SnapshotContext.h"
+
+#include "../Util/Base.h"
+
+#include <algorithm>
+#include <cstring>
+
+void SnapshotContext::Reset()
+{
+	for (Snapshot& snapshot : m_SentSnapshots)
+	{
+		snapshot.m_Valid = false;
+	}
+	for (Snapshot& snapshot : m_ReceivedSnapshots)
+	{
+		snapshot.m_Valid = false;
+	}
+
+	m_NextSnapshotID = 0;
+	m_HasQueuedSnapshot = false;
+	m_BaselineID = 0;
+	m_HasBaseline = false;
+	m_NewestReceived = 0;
+	m_HasReceived = false;
+}
+
+bool SnapshotContext::QueueSnapshot(const void* data, int size, uint16_t& snapshotID)
+{
+	if (size < 0 || size > (int)k_MaxSnapshotSize)
+	{
+		return false;
+	}
+
+	if (m_SentSnapshots.empty())
+	{
+		m_SentSnapshots.resize(k_SnapshotBufferSize);
+	}
+
+	snapshotID = m_NextSnapshotID++;
+	Snapshot& snapshot = m_SentSnapshots[snapshotID % k_SnapshotBufferSize];
+	snapshot.m_SnapshotID = snapshotID;
+	snapshot.m_Size = (uint16_t)size;
+	snapshot.m_Valid = true;
+	snapshot.m_Sent = false;
+	snapshot.m_Acked = false;
+	if (size > 0)
+	{
+		memcpy(snapshot.m_Data.data(), data, size);
+	}
+	memset(&snapshot.m_Data[size], 0, k_MaxSnapshotSize - size);
+
+	m_HasQueuedSnapshot = true;
+	return true;
+}
+
+int SnapshotContext::WriteSnapshot(uint16_t packetSequence, uint8_t* buffer, int capacity)
+{
+	if (!m_HasQueuedSnapshot)
+	{
+		return 0;
+	}
+
+	uint16_t snapshotID = m_NextSnapshotID - 1;
+	Snapshot& snapshot = m_SentSnapshots[snapshotID % k_SnapshotBufferSize];
+
+	// Encode against the baseline if it is still kept, otherwise (or if the delta is larger) send full state
+	uint8_t encoded[k_MaxSequencedMessageSize];
+	int encodedSize{ 0 };
+	uint16_t distance = snapshotID - m_BaselineID;
+	if (m_HasBaseline && distance > 0 && distance < k_SnapshotBufferSize)
+	{
+		const Snapshot& baseline = m_SentSnapshots[m_BaselineID % k_SnapshotBufferSize];
+		if (baseline.m_Valid && baseline.m_SnapshotID == m_BaselineID)
+		{
+			encodedSize = EncodeDelta(snapshot, baseline, (uint8_t)distance, encoded);
+		}
+	}
+	if (encodedSize == 0)
+	{
+		encoded[0] = 0;
+		memcpy(&encoded[k_SnapshotHeaderSize], snapshot.m_Data.data(), snapshot.m_Size);
+		encodedSize = (int)k_SnapshotHeaderSize + snapshot.m_Size;
+	}
+
+	if ((int)k_SequencedRecordHeaderSize + encodedSize > capacity)
+	{
+		return 0;
+	}
+
+	snapshot.m_Sent = true;
+	snapshot.m_PacketSequence = packetSequence;
+	m_HasQueuedSnapshot = false;
+	return WriteMessageRecord(buffer, ChannelType::Snapshot, snapshotID, encoded, encodedSize);
+}
+
+void SnapshotContext::OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField)
+{
+	for (Snapshot& snapshot : m_SentSnapshots)
+	{
+		if (!snapshot.m_Valid || !snapshot.m_Sent || snapshot.m_Acked)
+		{
+			continue;
+		}
+
+		// Packets older than the ack field can no longer be acknowledged
+		uint16_t distance = newestSequence - snapshot.m_PacketSequence;
+		if (distance >= 32)
+		{
+			snapshot.m_Sent = false;
+			continue;
+		}
+		if (!(acknowledgedField & (1u << distance)))
+		{
+			continue;
+		}
+
+		// The newest acknowledged snapshot is the baseline (wrapping comparison)
+		snapshot.m_Acked = true;
+		if (!m_HasBaseline || (int16_t)(snapshot.m_SnapshotID - m_BaselineID) > 0)
+		{
+			m_BaselineID = snapshot.m_SnapshotID;
+			m_HasBaseline = true;
+		}
+	}
+}
+
+bool SnapshotContext::ReceiveSnapshot(uint16_t snapshotID, const uint8_t* data, int size, const uint8_t*& state, int& stateSize)
+{
+	if (size < (int)k_SnapshotHeaderSize)
+	{
+		return false;
+	}
+
+	if (m_ReceivedSnapshots.empty())
+	{
+		m_ReceivedSnapshots.resize(k_SnapshotBufferSize);
+	}
+
+	// Drop duplicates and snapshots too old to be kept
+	Snapshot& snapshot = m_ReceivedSnapshots[snapshotID % k_SnapshotBufferSize];
+	if (snapshot.m_Valid && (int16_t)(snapshotID - snapshot.m_SnapshotID) <= 0)
+	{
+		return false;
+	}
+
+	uint8_t distance = data[0];
+	if (distance == 0)
+	{
+		int fullSize = size - (int)k_SnapshotHeaderSize;
+		if (fullSize > (int)k_MaxSnapshotSize)
+		{
+			return false;
+		}
+		memcpy(snapshot.m_Data.data(), &data[k_SnapshotHeaderSize], fullSize);
+		memset(&snapshot.m_Data[fullSize], 0, k_MaxSnapshotSize - fullSize);
+		snapshot.m_Size = (uint16_t)fullSize;
+	}
+	else
+	{
+		// The sender only uses baselines the receiver acknowledged, so a missing one means the
+		//		snapshot is malformed
+		uint16_t baselineID = snapshotID - distance;
+		const Snapshot& baseline = m_ReceivedSnapshots[baselineID % k_SnapshotBufferSize];
+		if (distance >= k_SnapshotBufferSize || !baseline.m_Valid || baseline.m_SnapshotID != baselineID ||
+			!DecodeDelta(data, size, baseline, snapshot))
+		{
+			snapshot.m_Valid = false;
+			return false;
+		}
+	}
+	snapshot.m_SnapshotID = snapshotID;
+	snapshot.m_Valid = true;
+
+	// Snapshots that arrive after a newer one are kept as baselines but not delivered
+	if (m_HasReceived && (int16_t)(snapshotID - m_NewestReceived) <= 0)
+	{
+		return false;
+	}
+	m_NewestReceived = snapshotID;
+	m_HasReceived = true;
+
+	state = snapshot.m_Data.data();
+	stateSize = snapshot.m_Size;
+	return true;
+}
+
+bool SnapshotContext::HasSnapshotToSend() const
+{
+	return m_HasQueuedSnapshot;
+}
+
+int SnapshotContext::EncodeDelta(const Snapshot& snapshot, const Snapshot& baseline, uint8_t distance, uint8_t* buffer)
+{
+	int fullSize = (int)k_SnapshotHeaderSize + snapshot.m_Size;
+	int numChunks = (int)((snapshot.m_Size + k_SnapshotChunkSize - 1) / k_SnapshotChunkSize);
+	int maskSize = (numChunks + 7) / 8;
+	int encodedSize = (int)k_SnapshotDeltaHeaderSize + maskSize;
+	if (encodedSize >= fullSize)
+	{
+		return 0;
+	}
+
+	buffer[0] = distance;
+	WriteUInt16(&buffer[k_SnapshotHeaderSize], snapshot.m_Size);
+	uint8_t* changeMask = &buffer[k_SnapshotDeltaHeaderSize];
+	memset(changeMask, 0, maskSize);
+
+	for (int chunkIndex{ 0 }; chunkIndex < numChunks; chunkIndex++)
+	{
+		size_t offset = chunkIndex * k_SnapshotChunkSize;
+		size_t chunkSize = std::min(k_SnapshotChunkSize, (size_t)snapshot.m_Size - offset);
+		if (memcmp(&snapshot.m_Data[offset], &baseline.m_Data[offset], chunkSize) == 0)
+		{
+			continue;
+		}
+
+		// Give up as soon as the delta is no smaller than full state
+		if (encodedSize + (int)chunkSize >= fullSize)
+		{
+			return 0;
+		}
+		changeMask[chunkIndex / 8] |= (uint8_t)(1 << (chunkIndex % 8));
+		memcpy(&buffer[encodedSize], &snapshot.m_Data[offset], chunkSize);
+		encodedSize += (int)chunkSize;
+	}
+
+	return encodedSize;
+}
+
+bool SnapshotContext::DecodeDelta(const uint8_t* data, int size, const Snapshot& baseline, Snapshot& snapshot)
+{
+	if (size < (int)k_SnapshotDeltaHeaderSize)
+	{
+		return false;
+	}
+
+	int stateSize = ReadUInt16(&data[k_SnapshotHeaderSize]);
+	int numChunks = (int)((stateSize + k_SnapshotChunkSize - 1) / k_SnapshotChunkSize);
+	int maskSize = (numChunks + 7) / 8;
+	int offset = (int)k_SnapshotDeltaHeaderSize + maskSize;
+	if (stateSize > (int)k_MaxSnapshotSize || offset > size)
+	{
+		return false;
+	}
+
+	// Unchanged chunks come from the baseline (zero past its size)
+	const uint8_t* changeMask = &data[k_SnapshotDeltaHeaderSize];
+	for (int chunkIndex{ 0 }; chunkIndex < numChunks; chunkIndex++)
+	{
+		size_t chunkOffset = chunkIndex * k_SnapshotChunkSize;
+		size_t chunkSize = std::min(k_SnapshotChunkSize, (size_t)stateSize - chunkOffset);
+		if (!(changeMask[chunkIndex / 8] & (1 << (chunkIndex % 8))))
+		{
+			memcpy(&snapshot.m_Data[chunkOffset], &baseline.m_Data[chunkOffset], chunkSize);
+			continue;
+		}
+
+		if (offset + (int)chunkSize > size)
+		{
+			return false;
+		}
+		memcpy(&snapshot.m_Data[chunkOffset], &data[offset], chunkSize);
+		offset += (int)chunkSize;
+	}
+
+	if (offset != size)
+	{
+		return false;
+	}
+	memset(&snapshot.m_Data[stateSize], 0, k_MaxSnapshotSize - stateSize);
+	snapshot.m_Size = (uint16_t)stateSize;
+	return true;
+}
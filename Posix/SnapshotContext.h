@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../Network/NetworkCommon.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Snapshots kept per direction, a baseline must be newer than the oldest one kept
+constexpr uint16_t k_SnapshotBufferSize{ 32 };
+// Bytes covered by each bit of a delta's change mask
+constexpr size_t k_SnapshotChunkSize{ 4 };
+// Snapshot records start with the distance to their baseline (0 for full state)
+constexpr size_t k_SnapshotHeaderSize{ sizeof(uint8_t) /*baselineDistance*/ };
+// A delta adds the state size and the change mask to the header
+constexpr size_t k_SnapshotDeltaHeaderSize{ k_SnapshotHeaderSize + sizeof(uint16_t) /*stateSize*/ };
+// Full state always fits a single record
+constexpr size_t k_MaxSnapshotSize{ k_MaxSequencedMessageSize - k_SnapshotHeaderSize };
+constexpr size_t k_MaxSnapshotChunks{ (k_MaxSnapshotSize + k_SnapshotChunkSize - 1) / k_SnapshotChunkSize };
+
+//==============================
+// Snapshot Context Class
+//==============================
+// Replicated state of one connection sent on the Snapshot channel. Only the newest queued snapshot
+//		is sent and it is never resent. It is encoded as a delta against the newest snapshot carried
+//		by an acknowledged packet (the baseline), which the receiver is known to hold. The delta is a
+//		change mask with one bit per k_SnapshotChunkSize bytes followed by the changed chunks
+//		(baselineDistance|stateSize|changeMask|chunks). Full state is sent while no baseline is
+//		acknowledged or when the delta would not be smaller (0|state).
+//		The receiver keeps every snapshot it decodes as a possible baseline, but only delivers
+//		snapshots newer than the newest one delivered.
+class SnapshotContext
+{
+public:
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Drop all sent and received snapshots (the rings are kept allocated)
+	void Reset();
+
+	//==============================
+	// Send Snapshots
+	//==============================
+	// Returns false if the state is too large. A snapshot that was not sent yet is replaced.
+	bool QueueSnapshot(const void* data, int size, uint16_t& snapshotID);
+	// Write the queued snapshot as a record if it fits. Returns the number of bytes written.
+	int WriteSnapshot(uint16_t packetSequence, uint8_t* buffer, int capacity);
+	// Snapshots carried by newly acknowledged packets become baselines (bit i of the field is the
+	//		sent packet newestSequence - i)
+	void OnPacketsAcknowledged(uint16_t newestSequence, uint32_t acknowledgedField);
+
+	//==============================
+	// Receive Snapshots
+	//==============================
+	// Decode a received record. Returns false if the snapshot should not be delivered (stale,
+	//		duplicated, malformed, or its baseline is missing), otherwise state points to the decoded
+	//		state until the next call.
+	bool ReceiveSnapshot(uint16_t snapshotID, const uint8_t* data, int size, const uint8_t*& state, int& stateSize);
+
+	//==============================
+	// Query Context
+	//==============================
+	bool HasSnapshotToSend() const;
+private:
+	//==============================
+	// Internal Structures
+	//==============================
+	struct Snapshot
+	{
+		uint16_t m_SnapshotID{ 0 };
+		uint16_t m_Size{ 0 };
+		// Sent snapshots only
+		uint16_t m_PacketSequence{ 0 };
+		bool m_Valid{ false };
+		bool m_Sent{ false };
+		bool m_Acked{ false };
+		// Bytes past m_Size are zero, so states of different sizes compare chunk by chunk
+		std::array<uint8_t, k_MaxSnapshotSize> m_Data;
+	};
+
+	// Returns the encoded size, or 0 if the delta is not smaller than full state
+	static int EncodeDelta(const Snapshot& snapshot, const Snapshot& baseline, uint8_t distance, uint8_t* buffer);
+	static bool DecodeDelta(const uint8_t* data, int size, const Snapshot& baseline, Snapshot& snapshot);
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	// Rings indexed by snapshot ID, allocated on the first snapshot
+	std::vector<Snapshot> m_SentSnapshots{};
+	std::vector<Snapshot> m_ReceivedSnapshots{};
+
+	uint16_t m_NextSnapshotID{ 0 };
+	bool m_HasQueuedSnapshot{ false };
+	// Newest snapshot carried by an acknowledged packet (valid once m_HasBaseline is set)
+	uint16_t m_BaselineID{ 0 };
+	bool m_HasBaseline{ false };
+
+	// Newest snapshot delivered (valid once m_HasReceived is set)
+	uint16_t m_NewestReceived{ 0 };
+	bool m_HasReceived{ false };
+};
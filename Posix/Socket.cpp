@@ -1,7 +1,8 @@
 #include "Socket.h"
+#include "../Util/Base.h"
 #include "stdio.h"
 
-bool Socket::Open(unsigned short m_Port)
+bool Socket::Open(unsigned short m_Port, bool reusePort)
 {
 	// Create the UDP socket
 	m_Handle = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
@@ -9,9 +10,28 @@ bool Socket::Open(unsigned short m_Port)
 	// Ensure the socket is created
 	if (m_Handle == -1)
 	{
-		// TODO: This call is windows specific
+#if PLATFORM == PLATFORM_WINDOWS
 		TSLogger::Log("Failed to create a socket: %d\n", WSAGetLastError());
+#else
+		TSLogger::Log("Failed to create a socket: %d\n", errno);
+#endif
+		return false;
+	}
+
+	// Optionally share the port with other sockets (must be set before binding)
+	if (reusePort)
+	{
+#if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
+		int enable = 1;
+		if (setsockopt(m_Handle, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0)
+		{
+			TSLogger::Log("Failed to enable port reuse: %d\n", errno);
+			return false;
+		}
+#elif PLATFORM == PLATFORM_WINDOWS
+		TSLogger::Log("Port reuse is not supported on this platform\n");
 		return false;
+#endif
 	}
 
 	// Create the socket's address
@@ -88,6 +108,186 @@ bool Socket::Send(const Address& destination, const void* data, int size)
 	return true;
 }
 
+int Socket::SendBatch(const PacketBatch& batch, int numPackets, const void* sharedPayload, int sharedPayloadSize)
+{
+	KG_ASSERT(numPackets <= k_MaxPacketBatchSize);
+
+#if PLATFORM == PLATFORM_UNIX
+	mmsghdr messages[k_MaxPacketBatchSize];
+	// Each datagram is gathered from its own buffer followed by the (optional) shared payload
+	iovec messageBuffers[k_MaxPacketBatchSize][2];
+	sockaddr_in destAddresses[k_MaxPacketBatchSize];
+
+	// Creating the destination address and message header for each datagram
+	for (int iteration{ 0 }; iteration < numPackets; iteration++)
+	{
+		destAddresses[iteration].sin_family = AF_INET;
+		destAddresses[iteration].sin_addr.s_addr = htonl(batch.m_Addresses[iteration].GetAddress());
+		destAddresses[iteration].sin_port = htons(batch.m_Addresses[iteration].GetPort());
+
+		messageBuffers[iteration][0].iov_base = (void*)batch.m_Buffers[iteration];
+		messageBuffers[iteration][0].iov_len = batch.m_Sizes[iteration];
+		messageBuffers[iteration][1].iov_base = (void*)sharedPayload;
+		messageBuffers[iteration][1].iov_len = sharedPayloadSize;
+
+		msghdr& header = messages[iteration].msg_hdr;
+		header = msghdr{};
+		header.msg_name = &destAddresses[iteration];
+		header.msg_namelen = sizeof(sockaddr_in);
+		header.msg_iov = messageBuffers[iteration];
+		header.msg_iovlen = sharedPayloadSize > 0 ? 2 : 1;
+	}
+
+	// Submit all datagrams, sendmmsg stops early at a datagram that fails (reported by the next call)
+	int numSent{ 0 };
+	int nextPacket{ 0 };
+	while (nextPacket < numPackets)
+	{
+		int result = sendmmsg(m_Handle, &messages[nextPacket], numPackets - nextPacket, 0);
+		if (result < 0)
+		{
+			// Stop once the send buffer is full, otherwise only the failing datagram is dropped
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				TSLogger::Log("Failed to send packet batch\n");
+				break;
+			}
+			TSLogger::Log("Failed to send packet: %d\n", errno);
+			nextPacket++;
+			continue;
+		}
+		if (result == 0)
+		{
+			break;
+		}
+		nextPacket += result;
+		numSent += result;
+	}
+
+	return numSent;
+#else
+	// Fall back to one send call per datagram
+	int numSent{ 0 };
+	for (int iteration{ 0 }; iteration < numPackets; iteration++)
+	{
+		if (SendGather(batch.m_Addresses[iteration], batch.m_Buffers[iteration], batch.m_Sizes[iteration],
+			sharedPayload, sharedPayloadSize))
+		{
+			numSent++;
+		}
+	}
+
+	return numSent;
+#endif
+}
+
+bool Socket::SendGather(const Address& destination, const void* header, int headerSize, const void* payload, int payloadSize)
+{
+	// Creating destination address
+	sockaddr_in destAddress;
+	destAddress.sin_family = AF_INET;
+	destAddress.sin_addr.s_addr = htonl(destination.GetAddress());
+	destAddress.sin_port = htons(destination.GetPort());
+
+	int numBuffers = payloadSize > 0 ? 2 : 1;
+
+#if PLATFORM == PLATFORM_WINDOWS
+	WSABUF buffers[2];
+	buffers[0].buf = (char*)header;
+	buffers[0].len = (ULONG)headerSize;
+	buffers[1].buf = (char*)payload;
+	buffers[1].len = (ULONG)payloadSize;
+
+	DWORD sent_bytes{ 0 };
+	int result = WSASendTo(m_Handle, buffers, numBuffers, &sent_bytes, 0, (sockaddr*)&destAddress,
+		sizeof(sockaddr_in), nullptr, nullptr);
+	bool success = result == 0 && (int)sent_bytes == headerSize + payloadSize;
+#else
+	iovec buffers[2];
+	buffers[0].iov_base = (void*)header;
+	buffers[0].iov_len = headerSize;
+	buffers[1].iov_base = (void*)payload;
+	buffers[1].iov_len = payloadSize;
+
+	msghdr message{};
+	message.msg_name = &destAddress;
+	message.msg_namelen = sizeof(sockaddr_in);
+	message.msg_iov = buffers;
+	message.msg_iovlen = numBuffers;
+
+	bool success = sendmsg(m_Handle, &message, 0) == headerSize + payloadSize;
+#endif
+
+	if (!success)
+	{
+		TSLogger::Log("Failed to send packet\n");
+		return false;
+	}
+	return true;
+}
+
+bool Socket::SendSegmented(const Address& destination, const void* data, int segmentSize, int totalSize)
+{
+	KG_ASSERT(segmentSize > 0);
+
+#if PLATFORM == PLATFORM_UNIX
+	if (m_SegmentationOffload && totalSize > segmentSize)
+	{
+		// Creating destination address
+		sockaddr_in destAddress;
+		destAddress.sin_family = AF_INET;
+		destAddress.sin_addr.s_addr = htonl(destination.GetAddress());
+		destAddress.sin_port = htons(destination.GetPort());
+
+		iovec buffer;
+		buffer.iov_base = (void*)data;
+		buffer.iov_len = totalSize;
+
+		// Attach the segment size so the kernel splits the buffer into individual datagrams
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))]{};
+		msghdr message{};
+		message.msg_name = &destAddress;
+		message.msg_namelen = sizeof(sockaddr_in);
+		message.msg_iov = &buffer;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+		controlMessage->cmsg_level = SOL_UDP;
+		controlMessage->cmsg_type = UDP_SEGMENT;
+		controlMessage->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		*(uint16_t*)CMSG_DATA(controlMessage) = (uint16_t)segmentSize;
+
+		if (sendmsg(m_Handle, &message, 0) == totalSize)
+		{
+			return true;
+		}
+
+		// Disable offload if the kernel/device does not support it, then fall back below
+		if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+		{
+			TSLogger::Log("UDP segmentation offload unavailable, falling back to individual sends\n");
+			m_SegmentationOffload = false;
+		}
+		else
+		{
+			TSLogger::Log("Failed to send segmented packet\n");
+			return false;
+		}
+	}
+#endif
+
+	// Send each segment as its own datagram
+	bool success{ true };
+	for (int offset{ 0 }; offset < totalSize; offset += segmentSize)
+	{
+		int size = totalSize - offset < segmentSize ? totalSize - offset : segmentSize;
+		success &= Send(destination, (const uint8_t*)data + offset, size);
+	}
+	return success;
+}
+
 int Socket::Receive(Address& sender, void* data, int size)
 {
 
@@ -111,6 +311,215 @@ int Socket::Receive(Address& sender, void* data, int size)
 	return bytes;
 }
 
+int Socket::ReceiveBatch(PacketBatch& batch)
+{
+#if PLATFORM == PLATFORM_UNIX
+	mmsghdr messages[k_MaxPacketBatchSize];
+	iovec messageBuffers[k_MaxPacketBatchSize];
+	sockaddr_in senderAddresses[k_MaxPacketBatchSize];
+
+	// Point each message header at its preallocated packet slot
+	for (int iteration{ 0 }; iteration < k_MaxPacketBatchSize; iteration++)
+	{
+		messageBuffers[iteration].iov_base = batch.m_Buffers[iteration];
+		messageBuffers[iteration].iov_len = k_MaxPacketSize;
+
+		msghdr& header = messages[iteration].msg_hdr;
+		header = msghdr{};
+		header.msg_name = &senderAddresses[iteration];
+		header.msg_namelen = sizeof(sockaddr_in);
+		header.msg_iov = &messageBuffers[iteration];
+		header.msg_iovlen = 1;
+	}
+
+	// Drain all available datagrams (up to the batch size) with a single syscall
+	int numMessages = recvmmsg(m_Handle, messages, k_MaxPacketBatchSize, MSG_DONTWAIT, nullptr);
+
+	if (numMessages <= 0)
+	{
+		return 0;
+	}
+
+	// Modify the senders' addresses and ports
+	for (int iteration{ 0 }; iteration < numMessages; iteration++)
+	{
+		batch.m_Addresses[iteration].SetAddress(ntohl(senderAddresses[iteration].sin_addr.s_addr));
+		batch.m_Addresses[iteration].SetNewPort(ntohs(senderAddresses[iteration].sin_port));
+		batch.m_Sizes[iteration] = (int)messages[iteration].msg_len;
+	}
+
+	return numMessages;
+#else
+	// Fall back to one receive call per datagram
+	int numMessages{ 0 };
+	while (numMessages < k_MaxPacketBatchSize)
+	{
+		int bytes = Receive(batch.m_Addresses[numMessages], batch.m_Buffers[numMessages], k_MaxPacketSize);
+		if (bytes <= 0)
+		{
+			break;
+		}
+
+		batch.m_Sizes[numMessages] = bytes;
+		numMessages++;
+	}
+
+	return numMessages;
+#endif
+}
+
+int Socket::ReceiveBatch(PacketHandle* packets, int numPackets)
+{
+	KG_ASSERT(numPackets <= k_MaxPacketBatchSize);
+
+#if PLATFORM == PLATFORM_UNIX
+	mmsghdr messages[k_MaxPacketBatchSize];
+	iovec messageBuffers[k_MaxPacketBatchSize];
+	sockaddr_in senderAddresses[k_MaxPacketBatchSize];
+
+	// Point each message header at its pooled buffer
+	for (int iteration{ 0 }; iteration < numPackets; iteration++)
+	{
+		messageBuffers[iteration].iov_base = packets[iteration].GetBuffer();
+		messageBuffers[iteration].iov_len = k_MaxPacketSize;
+
+		msghdr& header = messages[iteration].msg_hdr;
+		header = msghdr{};
+		header.msg_name = &senderAddresses[iteration];
+		header.msg_namelen = sizeof(sockaddr_in);
+		header.msg_iov = &messageBuffers[iteration];
+		header.msg_iovlen = 1;
+	}
+
+	int numMessages = recvmmsg(m_Handle, messages, numPackets, MSG_DONTWAIT, nullptr);
+
+	if (numMessages <= 0)
+	{
+		return 0;
+	}
+
+	for (int iteration{ 0 }; iteration < numMessages; iteration++)
+	{
+		Address sender;
+		sender.SetAddress(ntohl(senderAddresses[iteration].sin_addr.s_addr));
+		sender.SetNewPort(ntohs(senderAddresses[iteration].sin_port));
+		packets[iteration].SetContents(sender, (int)messages[iteration].msg_len);
+	}
+
+	return numMessages;
+#else
+	// Fall back to one receive call per datagram
+	int numMessages{ 0 };
+	while (numMessages < numPackets)
+	{
+		Address sender;
+		int bytes = Receive(sender, packets[numMessages].GetBuffer(), k_MaxPacketSize);
+		if (bytes <= 0)
+		{
+			break;
+		}
+
+		packets[numMessages].SetContents(sender, bytes);
+		numMessages++;
+	}
+
+	return numMessages;
+#endif
+}
+
+int Socket::ReceiveCoalesced(CoalescedPacket& packet)
+{
+	KG_ASSERT(packet.m_Buffer.size() >= k_MaxCoalescedSize);
+
+#if PLATFORM == PLATFORM_UNIX
+	sockaddr_in from;
+	iovec buffer;
+	buffer.iov_base = packet.m_Buffer.data();
+	buffer.iov_len = packet.m_Buffer.size();
+
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+	msghdr message{};
+	message.msg_name = &from;
+	message.msg_namelen = sizeof(from);
+	message.msg_iov = &buffer;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	int bytes = (int)recvmsg(m_Handle, &message, MSG_DONTWAIT);
+	if (bytes <= 0)
+	{
+		return 0;
+	}
+
+	// The segment size is only attached when the kernel actually coalesced datagrams
+	packet.m_SegmentSize = bytes;
+	for (cmsghdr* controlMessage = CMSG_FIRSTHDR(&message); controlMessage;
+		controlMessage = CMSG_NXTHDR(&message, controlMessage))
+	{
+		if (controlMessage->cmsg_level == SOL_UDP && controlMessage->cmsg_type == UDP_GRO)
+		{
+			packet.m_SegmentSize = *(int*)CMSG_DATA(controlMessage);
+		}
+	}
+
+	// Modify the sender's address and port
+	packet.m_Sender.SetAddress(ntohl(from.sin_addr.s_addr));
+	packet.m_Sender.SetNewPort(ntohs(from.sin_port));
+	return bytes;
+#else
+	int bytes = Receive(packet.m_Sender, packet.m_Buffer.data(), (int)packet.m_Buffer.size());
+	packet.m_SegmentSize = bytes;
+	return bytes;
+#endif
+}
+
+bool Socket::EnableReceiveCoalescing()
+{
+#if PLATFORM == PLATFORM_UNIX
+	int enable = 1;
+	if (setsockopt(m_Handle, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) != 0)
+	{
+		TSLogger::Log("Failed to enable UDP receive coalescing: %d\n", errno);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Socket::EnablePathMtuProbing()
+{
+#if PLATFORM == PLATFORM_UNIX
+	int mode = IP_PMTUDISC_PROBE;
+	if (setsockopt(m_Handle, IPPROTO_IP, IP_MTU_DISCOVER, &mode, sizeof(mode)) != 0)
+	{
+		TSLogger::Log("Failed to enable path MTU probing: %d\n", errno);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if PLATFORM == PLATFORM_UNIX
+bool Socket::AttachReusePortFilter(sock_filter* instructions, unsigned short numInstructions)
+{
+	sock_fprog program{};
+	program.len = numInstructions;
+	program.filter = instructions;
+
+	if (setsockopt(m_Handle, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) != 0)
+	{
+		TSLogger::Log("Failed to attach the reuse port filter: %d\n", errno);
+		return false;
+	}
+	return true;
+}
+#endif
+
 bool SocketContext::InitializeSockets()
 {
 #if PLATFORM == PLATFORM_WINDOWS
@@ -1,8 +1,43 @@
 #pragma once
 #include "PosixImpl.h"
 #include "Address.h"
+#include "PacketPool.h"
+#include "../Network/NetworkCommon.h"
 #include "../Util/Logger.h"
 
+#include <cstdint>
+#include <vector>
+
+//===========================
+// Packet Batch
+//===========================
+
+constexpr int k_MaxPacketBatchSize{ 64 };
+
+// Preallocated storage for the datagrams moved by a single Socket::ReceiveBatch/SendBatch call
+struct PacketBatch
+{
+	uint8_t m_Buffers[k_MaxPacketBatchSize][k_MaxPacketSize];
+	// Sender addresses when receiving, destination addresses when sending
+	Address m_Addresses[k_MaxPacketBatchSize];
+	int m_Sizes[k_MaxPacketBatchSize];
+};
+
+//===========================
+// Coalesced Packet
+//===========================
+
+constexpr int k_MaxCoalescedSize{ 65535 };
+
+// Train of same-sender datagrams the kernel merged into one receive (UDP GRO). Every datagram
+//		is m_SegmentSize bytes except the last one, which may be shorter.
+struct CoalescedPacket
+{
+	std::vector<uint8_t> m_Buffer;
+	Address m_Sender;
+	int m_SegmentSize{ 0 };
+};
+
 class Socket
 {
 public:
@@ -15,14 +50,44 @@ public:
 	//==============================
 	// Lifecycle Functions
 	//==============================
-	bool Open(unsigned short m_Port);
+	// reusePort allows several sockets to share the port, the kernel balances datagrams between them
+	bool Open(unsigned short m_Port, bool reusePort = false);
 	void Close();
 
 	//==============================
 	// Send/Receive Messages
 	//==============================
 	bool Send(const Address& destination, const void* data, int size);
+	// Send the first numPackets datagrams of the batch. The optional shared payload is appended to
+	//		every datagram without being copied into the batch. Returns the number of datagrams sent.
+	int SendBatch(const PacketBatch& batch, int numPackets, const void* sharedPayload = nullptr, int sharedPayloadSize = 0);
+	// Send a single datagram gathered from a header and payload buffer
+	bool SendGather(const Address& destination, const void* header, int headerSize, const void* payload, int payloadSize);
+	// Send a train of back-to-back segmentSize datagrams (the last one may be shorter) to one destination.
+	//		Uses UDP generic segmentation offload when available, otherwise one send per datagram.
+	bool SendSegmented(const Address& destination, const void* data, int segmentSize, int totalSize);
 	int Receive(Address& sender, void* data, int size);
+	// Receive up to k_MaxPacketBatchSize datagrams. Returns the number of datagrams received.
+	int ReceiveBatch(PacketBatch& batch);
+	// Receive up to numPackets datagrams directly into the pooled buffers. The sender and size of
+	//		each filled handle are set. Returns the number of datagrams received.
+	int ReceiveBatch(PacketHandle* packets, int numPackets);
+	// Receive a (possibly coalesced) train of datagrams. Returns the total number of bytes received.
+	int ReceiveCoalesced(CoalescedPacket& packet);
+
+	//==============================
+	// Configure Socket
+	//==============================
+	// Allow the kernel to coalesce same-flow datagrams into a single receive (Linux UDP GRO)
+	bool EnableReceiveCoalescing();
+	// Send every datagram unfragmented regardless of the kernel's path MTU estimate, so path probes
+	//		larger than the path are dropped instead of fragmented (Linux only)
+	bool EnablePathMtuProbing();
+#if PLATFORM == PLATFORM_UNIX
+	// Attach a classic BPF program that selects the destination socket within this socket's
+	//		SO_REUSEPORT group (the program returns the group index, sockets are indexed in bind order)
+	bool AttachReusePortFilter(sock_filter* instructions, unsigned short numInstructions);
+#endif
 
 	//==============================
 	// Query Socket State
@@ -38,6 +103,7 @@ private:
 	// Internal Fields
 	//==============================
 	int m_Handle;
+	bool m_SegmentationOffload{ true };
 };
 
 //===========================
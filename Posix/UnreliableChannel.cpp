@@ -0,0 +1,108 @@
+#include "UnreliableChannel.h"
+
+#include "../Util/Base.h"
+
+#include <cstring>
+
+void UnreliableChannel::Init(ChannelType channel)
+{
+	KG_ASSERT(channel == ChannelType::Unreliable || channel == ChannelType::UnreliableSequenced);
+
+	m_Channel = channel;
+	Reset();
+}
+
+void UnreliableChannel::Reset()
+{
+	m_QueueHead = 0;
+	m_QueueCount = 0;
+	m_NextMessageID = 0;
+	m_NewestReceived = 0;
+	m_HasReceived = false;
+}
+
+bool UnreliableChannel::QueueMessage(const void* data, int size, uint16_t& messageID)
+{
+	if (size < 0 || size > GetMaxMessageSize(m_Channel))
+	{
+		return false;
+	}
+
+	if (m_Queue.empty())
+	{
+		m_Queue.resize(k_MaxQueuedUnreliableMessages);
+	}
+
+	// A newer sequenced message supersedes the oldest queued one
+	if (m_QueueCount >= k_MaxQueuedUnreliableMessages)
+	{
+		if (m_Channel != ChannelType::UnreliableSequenced)
+		{
+			return false;
+		}
+		m_QueueHead = (m_QueueHead + 1) % k_MaxQueuedUnreliableMessages;
+		m_QueueCount--;
+	}
+
+	messageID = m_NextMessageID++;
+	QueuedMessage& message = m_Queue[(m_QueueHead + m_QueueCount) % k_MaxQueuedUnreliableMessages];
+	message.m_MessageID = messageID;
+	message.m_Size = (uint16_t)size;
+	if (size > 0)
+	{
+		memcpy(message.m_Data.data(), data, size);
+	}
+	m_QueueCount++;
+	return true;
+}
+
+int UnreliableChannel::WriteMessages(uint8_t* buffer, int capacity, int budget)
+{
+	int bytesWritten{ 0 };
+
+	// Keep the queue order, so a message that does not fit holds back the messages behind it
+	while (m_QueueCount > 0)
+	{
+		QueuedMessage& message = m_Queue[m_QueueHead];
+		int recordSize = GetMessageRecordHeaderSize(m_Channel) + message.m_Size;
+		if (bytesWritten + recordSize > capacity || (bytesWritten > 0 && bytesWritten + recordSize > budget))
+		{
+			break;
+		}
+
+		bytesWritten += WriteMessageRecord(&buffer[bytesWritten], m_Channel, message.m_MessageID,
+			message.m_Data.data(), message.m_Size);
+		m_QueueHead = (m_QueueHead + 1) % k_MaxQueuedUnreliableMessages;
+		m_QueueCount--;
+	}
+
+	return bytesWritten;
+}
+
+bool UnreliableChannel::ReceiveMessage(uint16_t messageID)
+{
+	if (m_Channel != ChannelType::UnreliableSequenced)
+	{
+		return true;
+	}
+
+	// Drop duplicates and messages that were overtaken by a newer one (wrapping comparison)
+	if (m_HasReceived && (int16_t)(messageID - m_NewestReceived) <= 0)
+	{
+		return false;
+	}
+
+	m_NewestReceived = messageID;
+	m_HasReceived = true;
+	return true;
+}
+
+ChannelType UnreliableChannel::GetChannelType() const
+{
+	return m_Channel;
+}
+
+bool UnreliableChannel::HasQueuedMessages() const
+{
+	return m_QueueCount > 0;
+}
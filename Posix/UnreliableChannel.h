@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../Network/NetworkCommon.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Number of unreliable messages that may wait for the next packet per channel
+constexpr uint16_t k_MaxQueuedUnreliableMessages{ 32 };
+
+//==============================
+// Unreliable Channel Class
+//==============================
+// Unreliable messages for one connection. Messages are queued until the next sequenced packet is
+//		written and are never resent. Sequenced channels number their messages so the receiver can
+//		drop messages that arrive after a newer one, and a full sequenced queue drops its oldest
+//		message instead of the new one (only the newest state matters).
+class UnreliableChannel
+{
+public:
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Set the channel type (Unreliable or UnreliableSequenced) and drop all state
+	void Init(ChannelType channel);
+	// Drop all queued and received state (the queue is kept allocated)
+	void Reset();
+
+	//==============================
+	// Send Messages
+	//==============================
+	// Returns false if the message is too large or the queue of an unsequenced channel is full
+	bool QueueMessage(const void* data, int size, uint16_t& messageID);
+	// Write queued messages as records in queue order until the next one does not fit. Records
+	//		past the first stop at the budget. Returns the number of bytes written.
+	int WriteMessages(uint8_t* buffer, int capacity, int budget);
+
+	//==============================
+	// Receive Messages
+	//==============================
+	// Returns false if the message should be dropped (sequenced messages older than the newest)
+	bool ReceiveMessage(uint16_t messageID);
+
+	//==============================
+	// Query Channel
+	//==============================
+	ChannelType GetChannelType() const;
+	bool HasQueuedMessages() const;
+private:
+	//==============================
+	// Internal Structures
+	//==============================
+	struct QueuedMessage
+	{
+		uint16_t m_MessageID{ 0 };
+		uint16_t m_Size{ 0 };
+		std::array<uint8_t, k_MaxMessageSize> m_Data;
+	};
+
+	//==============================
+	// Internal Fields
+	//==============================
+	ChannelType m_Channel{ ChannelType::Unreliable };
+
+	// Ring of queued messages starting at m_QueueHead, allocated on the first queued message
+	std::vector<QueuedMessage> m_Queue{};
+	uint16_t m_QueueHead{ 0 };
+	uint16_t m_QueueCount{ 0 };
+	uint16_t m_NextMessageID{ 0 };
+
+	// Newest sequenced message received (valid once m_HasReceived is set)
+	uint16_t m_NewestReceived{ 0 };
+	bool m_HasReceived{ false };
+};
@@ -0,0 +1,434 @@
+#include "UringSocket.h"
+#include "../Util/Base.h"
+
+#if PLATFORM == PLATFORM_UNIX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// Buffer group used for the provided receive buffers
+constexpr uint16_t k_ReceiveBufferGroup{ 0 };
+// User data tag of the multishot receive (send completions use their slot index)
+constexpr uint64_t k_ReceiveUserData{ UINT64_MAX };
+// Each provided buffer holds the recvmsg header, the sender's address, and the packet
+constexpr size_t k_ReceiveBufferSize{ sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + k_MaxPacketSize };
+// The multishot receive is no longer re-armed after this many consecutive failures
+constexpr int k_MaxReceiveErrors{ 8 };
+
+static int UringSetup(uint32_t entries, io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int UringEnter(int ringHandle, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ringHandle, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int UringRegister(int ringHandle, uint32_t opcode, void* arg, uint32_t numArgs)
+{
+	return (int)syscall(__NR_io_uring_register, ringHandle, opcode, arg, numArgs);
+}
+
+static uint32_t LoadAcquire(uint32_t* location)
+{
+	return std::atomic_ref<uint32_t>(*location).load(std::memory_order_acquire);
+}
+
+static void StoreRelease(uint32_t* location, uint32_t value)
+{
+	std::atomic_ref<uint32_t>(*location).store(value, std::memory_order_release);
+}
+
+bool UringSocket::Init(Socket& socket)
+{
+	m_Socket = &socket;
+
+	// Create the ring (completion queue sized for a burst of receives plus all sends)
+	io_uring_params params{};
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = (k_UringReceiveBufferCount + k_UringSendSlotCount) * 2;
+	m_RingHandle = UringSetup(k_UringSendSlotCount, &params);
+	if (m_RingHandle < 0)
+	{
+		TSLogger::Log("Failed to create io_uring instance: %d\n", errno);
+		m_RingHandle = -1;
+		return false;
+	}
+
+	// Map the submission/completion rings and the submission entries
+	m_SubmissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	m_CompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (singleMap)
+	{
+		m_SubmissionRingSize = m_CompletionRingSize = std::max(m_SubmissionRingSize, m_CompletionRingSize);
+	}
+
+	m_SubmissionRing = mmap(nullptr, m_SubmissionRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, m_RingHandle, IORING_OFF_SQ_RING);
+	m_CompletionRing = singleMap ? m_SubmissionRing : mmap(nullptr, m_CompletionRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, m_RingHandle, IORING_OFF_CQ_RING);
+	m_SubmissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_SubmissionEntries = (io_uring_sqe*)mmap(nullptr, m_SubmissionEntriesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, m_RingHandle, IORING_OFF_SQES);
+
+	if (m_SubmissionRing == MAP_FAILED || m_CompletionRing == MAP_FAILED || m_SubmissionEntries == MAP_FAILED)
+	{
+		TSLogger::Log("Failed to map io_uring memory: %d\n", errno);
+		Terminate();
+		return false;
+	}
+
+	uint8_t* submissionRing = (uint8_t*)m_SubmissionRing;
+	m_SubmissionHead = (uint32_t*)(submissionRing + params.sq_off.head);
+	m_SubmissionTail = (uint32_t*)(submissionRing + params.sq_off.tail);
+	m_SubmissionArray = (uint32_t*)(submissionRing + params.sq_off.array);
+	m_SubmissionMask = *(uint32_t*)(submissionRing + params.sq_off.ring_mask);
+	m_SubmissionCapacity = params.sq_entries;
+
+	uint8_t* completionRing = (uint8_t*)m_CompletionRing;
+	m_CompletionHead = (uint32_t*)(completionRing + params.cq_off.head);
+	m_CompletionTail = (uint32_t*)(completionRing + params.cq_off.tail);
+	m_CompletionMask = *(uint32_t*)(completionRing + params.cq_off.ring_mask);
+	m_CompletionEntries = (io_uring_cqe*)(completionRing + params.cq_off.cqes);
+
+	// Register the provided buffer ring (must be page aligned)
+	m_ReceiveBufferRingSize = k_UringReceiveBufferCount * sizeof(io_uring_buf);
+	m_ReceiveBufferRing = (io_uring_buf_ring*)mmap(nullptr, m_ReceiveBufferRingSize, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (m_ReceiveBufferRing == MAP_FAILED)
+	{
+		m_ReceiveBufferRing = nullptr;
+		TSLogger::Log("Failed to allocate the io_uring buffer ring\n");
+		Terminate();
+		return false;
+	}
+
+	io_uring_buf_reg bufferRegistration{};
+	bufferRegistration.ring_addr = (uint64_t)m_ReceiveBufferRing;
+	bufferRegistration.ring_entries = k_UringReceiveBufferCount;
+	bufferRegistration.bgid = k_ReceiveBufferGroup;
+	if (UringRegister(m_RingHandle, IORING_REGISTER_PBUF_RING, &bufferRegistration, 1) != 0)
+	{
+		TSLogger::Log("Failed to register io_uring provided buffers: %d\n", errno);
+		Terminate();
+		return false;
+	}
+
+	// Provide all receive buffers to the kernel
+	m_ReceiveBuffers.resize(k_UringReceiveBufferCount * k_ReceiveBufferSize);
+	m_ReceiveBufferRing->tail = 0;
+	for (uint16_t bufferID{ 0 }; bufferID < k_UringReceiveBufferCount; bufferID++)
+	{
+		RecycleReceiveBuffer(bufferID);
+	}
+
+	// Initialize the send slots
+	m_SendSlots.resize(k_UringSendSlotCount);
+	m_FreeSendSlots.clear();
+	for (uint32_t slotIndex{ 0 }; slotIndex < k_UringSendSlotCount; slotIndex++)
+	{
+		m_FreeSendSlots.push_back(k_UringSendSlotCount - 1 - slotIndex);
+	}
+
+	// Template for the multishot receive (only the name is requested, no control data)
+	m_ReceiveMessage = msghdr{};
+	m_ReceiveMessage.msg_namelen = sizeof(sockaddr_in);
+
+	ArmReceive();
+	SubmitSends();
+
+	// Multishot recvmsg needs Linux 6.0 while provided buffer rings work from 5.19. Older kernels
+	//		reject the receive while it is submitted, so its completion is already posted.
+	uint32_t tail = LoadAcquire(m_CompletionTail);
+	for (uint32_t head = *m_CompletionHead; head != tail; head++)
+	{
+		const io_uring_cqe& completion = m_CompletionEntries[head & m_CompletionMask];
+		if (completion.user_data == k_ReceiveUserData && completion.res < 0 && !(completion.flags & IORING_CQE_F_MORE))
+		{
+			TSLogger::Log("io_uring multishot receives are not supported: %d\n", -completion.res);
+			Terminate();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UringSocket::Terminate()
+{
+	if (m_RingHandle != -1)
+	{
+		close(m_RingHandle);
+		m_RingHandle = -1;
+	}
+	if (m_SubmissionEntries && m_SubmissionEntries != MAP_FAILED)
+	{
+		munmap(m_SubmissionEntries, m_SubmissionEntriesSize);
+	}
+	if (m_CompletionRing && m_CompletionRing != MAP_FAILED && m_CompletionRing != m_SubmissionRing)
+	{
+		munmap(m_CompletionRing, m_CompletionRingSize);
+	}
+	if (m_SubmissionRing && m_SubmissionRing != MAP_FAILED)
+	{
+		munmap(m_SubmissionRing, m_SubmissionRingSize);
+	}
+	if (m_ReceiveBufferRing)
+	{
+		munmap(m_ReceiveBufferRing, m_ReceiveBufferRingSize);
+	}
+
+	m_SubmissionEntries = nullptr;
+	m_CompletionRing = nullptr;
+	m_SubmissionRing = nullptr;
+	m_ReceiveBufferRing = nullptr;
+	m_ReceiveArmed = false;
+	m_ReceiveErrorCount = 0;
+	m_PendingSubmissions = 0;
+	m_ReceiveBuffers.clear();
+	m_SendSlots.clear();
+	m_FreeSendSlots.clear();
+}
+
+bool UringSocket::QueueSend(const Address& destination, const void* header, int headerSize, const void* payload, int payloadSize)
+{
+	KG_ASSERT(headerSize + payloadSize <= (int)k_MaxPacketSize);
+
+	// Fall back to a direct send if every slot is in flight
+	io_uring_sqe* entry = m_FreeSendSlots.empty() ? nullptr : GetSubmissionEntry();
+	if (!entry)
+	{
+		return m_Socket->SendGather(destination, header, headerSize, payload, payloadSize);
+	}
+
+	uint32_t slotIndex = m_FreeSendSlots.back();
+	m_FreeSendSlots.pop_back();
+	SendSlot& slot = m_SendSlots[slotIndex];
+
+	// Copy the datagram into the slot so it outlives the caller's buffers
+	memcpy(slot.m_Buffer, header, headerSize);
+	if (payloadSize > 0)
+	{
+		memcpy(slot.m_Buffer + headerSize, payload, payloadSize);
+	}
+
+	slot.m_Destination.sin_family = AF_INET;
+	slot.m_Destination.sin_addr.s_addr = htonl(destination.GetAddress());
+	slot.m_Destination.sin_port = htons(destination.GetPort());
+	slot.m_BufferLocation.iov_base = slot.m_Buffer;
+	slot.m_BufferLocation.iov_len = headerSize + payloadSize;
+	slot.m_Message = msghdr{};
+	slot.m_Message.msg_name = &slot.m_Destination;
+	slot.m_Message.msg_namelen = sizeof(sockaddr_in);
+	slot.m_Message.msg_iov = &slot.m_BufferLocation;
+	slot.m_Message.msg_iovlen = 1;
+
+	entry->opcode = IORING_OP_SENDMSG;
+	entry->fd = m_Socket->GetHandle();
+	entry->addr = (uint64_t)&slot.m_Message;
+	entry->len = 1;
+	entry->user_data = slotIndex;
+
+	return true;
+}
+
+void UringSocket::SubmitSends()
+{
+	if (m_PendingSubmissions == 0)
+	{
+		return;
+	}
+
+	int result = UringEnter(m_RingHandle, m_PendingSubmissions, 0, 0);
+	if (result < 0)
+	{
+		TSLogger::Log("Failed to submit io_uring entries: %d\n", errno);
+		return;
+	}
+	m_PendingSubmissions -= (uint32_t)result;
+}
+
+int UringSocket::ReceivePackets(const ReceivedPacketFn& handler)
+{
+	int numPackets{ 0 };
+
+	uint32_t head = *m_CompletionHead;
+	uint32_t tail = LoadAcquire(m_CompletionTail);
+
+	for (; head != tail; head++)
+	{
+		io_uring_cqe& completion = m_CompletionEntries[head & m_CompletionMask];
+
+		// Handle send completions
+		if (completion.user_data != k_ReceiveUserData)
+		{
+			if (completion.res < 0)
+			{
+				TSLogger::Log("Failed to send packet\n");
+			}
+			m_FreeSendSlots.push_back((uint32_t)completion.user_data);
+			continue;
+		}
+
+		// Re-arm the multishot receive once the kernel terminates it
+		if (!(completion.flags & IORING_CQE_F_MORE))
+		{
+			m_ReceiveArmed = false;
+		}
+
+		// Running out of provided buffers is recovered by re-arming, other errors are counted
+		if (completion.res < 0)
+		{
+			if (completion.res != -ENOBUFS && ++m_ReceiveErrorCount == k_MaxReceiveErrors)
+			{
+				TSLogger::Log("Stopped io_uring receives after repeated failures: %d\n", -completion.res);
+			}
+			continue;
+		}
+		if (!(completion.flags & IORING_CQE_F_BUFFER))
+		{
+			continue;
+		}
+		m_ReceiveErrorCount = 0;
+
+		uint16_t bufferID = (uint16_t)(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+		uint8_t* buffer = &m_ReceiveBuffers[bufferID * k_ReceiveBufferSize];
+		io_uring_recvmsg_out* messageOut = (io_uring_recvmsg_out*)buffer;
+
+		// Note that any packets larger than the max size are silently discarded!
+		if (!(messageOut->flags & MSG_TRUNC) && messageOut->namelen >= sizeof(sockaddr_in))
+		{
+			sockaddr_in* from = (sockaddr_in*)(buffer + sizeof(io_uring_recvmsg_out));
+			Address sender;
+			sender.SetAddress(ntohl(from->sin_addr.s_addr));
+			sender.SetNewPort(ntohs(from->sin_port));
+
+			uint8_t* payload = buffer + sizeof(io_uring_recvmsg_out) + m_ReceiveMessage.msg_namelen;
+			handler(sender, payload, (int)messageOut->payloadlen);
+			numPackets++;
+		}
+
+		// Give the buffer back to the kernel
+		RecycleReceiveBuffer(bufferID);
+	}
+
+	StoreRelease(m_CompletionHead, head);
+
+	if (!m_ReceiveArmed && m_ReceiveErrorCount < k_MaxReceiveErrors)
+	{
+		ArmReceive();
+	}
+
+	// Submit the re-armed receive along with any sends queued by the handler
+	SubmitSends();
+
+	return numPackets;
+}
+
+int UringSocket::GetCompletionHandle() const
+{
+	return m_RingHandle;
+}
+
+bool UringSocket::IsInitialized() const
+{
+	return m_RingHandle != -1;
+}
+
+io_uring_sqe* UringSocket::GetSubmissionEntry()
+{
+	uint32_t tail = *m_SubmissionTail;
+
+	// Submit pending entries if the submission queue is full
+	if (tail - LoadAcquire(m_SubmissionHead) >= m_SubmissionCapacity)
+	{
+		SubmitSends();
+		if (tail - LoadAcquire(m_SubmissionHead) >= m_SubmissionCapacity)
+		{
+			return nullptr;
+		}
+	}
+
+	uint32_t index = tail & m_SubmissionMask;
+	io_uring_sqe* entry = &m_SubmissionEntries[index];
+	memset(entry, 0, sizeof(io_uring_sqe));
+	m_SubmissionArray[index] = index;
+	StoreRelease(m_SubmissionTail, tail + 1);
+	m_PendingSubmissions++;
+
+	return entry;
+}
+
+void UringSocket::ArmReceive()
+{
+	io_uring_sqe* entry = GetSubmissionEntry();
+	if (!entry)
+	{
+		return;
+	}
+
+	// A single multishot recvmsg keeps posting completions into provided buffers
+	entry->opcode = IORING_OP_RECVMSG;
+	entry->fd = m_Socket->GetHandle();
+	entry->addr = (uint64_t)&m_ReceiveMessage;
+	entry->ioprio = IORING_RECV_MULTISHOT;
+	entry->flags = IOSQE_BUFFER_SELECT;
+	entry->buf_group = k_ReceiveBufferGroup;
+	entry->user_data = k_ReceiveUserData;
+	m_ReceiveArmed = true;
+}
+
+void UringSocket::RecycleReceiveBuffer(uint16_t bufferID)
+{
+	// The ring entries start at the ring base (the tail overlays the first entry's reserved field).
+	//		bufs is not used since the flexible array declaration is offset when compiled as C++.
+	uint16_t tail = m_ReceiveBufferRing->tail;
+	io_uring_buf& buffer = ((io_uring_buf*)m_ReceiveBufferRing)[tail & (k_UringReceiveBufferCount - 1)];
+	buffer.addr = (uint64_t)&m_ReceiveBuffers[bufferID * k_ReceiveBufferSize];
+	buffer.len = (uint32_t)k_ReceiveBufferSize;
+	buffer.bid = bufferID;
+
+	std::atomic_ref<uint16_t>(m_ReceiveBufferRing->tail).store(tail + 1, std::memory_order_release);
+}
+
+#else
+
+bool UringSocket::Init(Socket& socket)
+{
+	TSLogger::Log("io_uring sockets are not supported on this platform\n");
+	return false;
+}
+
+void UringSocket::Terminate()
+{
+}
+
+bool UringSocket::QueueSend(const Address& destination, const void* header, int headerSize, const void* payload, int payloadSize)
+{
+	return false;
+}
+
+void UringSocket::SubmitSends()
+{
+}
+
+int UringSocket::ReceivePackets(const ReceivedPacketFn& handler)
+{
+	return 0;
+}
+
+int UringSocket::GetCompletionHandle() const
+{
+	return -1;
+}
+
+bool UringSocket::IsInitialized() const
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+#include "PosixImpl.h"
+#include "Socket.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+using ReceivedPacketFn = std::function<void(const Address&, uint8_t*, int)>;
+
+constexpr uint32_t k_UringReceiveBufferCount{ 256 }; // Must be a power of two
+constexpr uint32_t k_UringSendSlotCount{ 256 };
+
+//==============================
+// Uring Socket Class
+//==============================
+// io_uring backend for an opened Socket (Linux only). Receives use a single multishot recvmsg
+//		that fills a provided-buffer ring of fixed k_MaxPacketSize buffers, and sends are queued as
+//		sendmsg SQEs and submitted together. The completion handle becomes readable whenever
+//		completions are available so it can be waited on by the NetworkReactor instead of the socket.
+class UringSocket
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	UringSocket() = default;
+	~UringSocket() = default;
+
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Returns false if io_uring (or a required feature) is unavailable
+	bool Init(Socket& socket);
+	void Terminate();
+
+	//==============================
+	// Send/Receive Messages
+	//==============================
+	// Queue a datagram gathered from a header and an optional payload (both are copied)
+	bool QueueSend(const Address& destination, const void* header, int headerSize, const void* payload, int payloadSize);
+	// Submit all queued sends with a single syscall
+	void SubmitSends();
+	// Reap completions, calling the handler for each received datagram. The buffer is only
+	//		valid during the call. Returns the number of datagrams received.
+	int ReceivePackets(const ReceivedPacketFn& handler);
+
+	//==============================
+	// Getters/Setters
+	//==============================
+	int GetCompletionHandle() const;
+	bool IsInitialized() const;
+
+#if PLATFORM == PLATFORM_UNIX
+private:
+	// Submission queue helpers
+	io_uring_sqe* GetSubmissionEntry();
+	void ArmReceive();
+	void RecycleReceiveBuffer(uint16_t bufferID);
+
+private:
+	//==============================
+	// Internal Structures
+	//==============================
+	struct SendSlot
+	{
+		uint8_t m_Buffer[k_MaxPacketSize];
+		sockaddr_in m_Destination;
+		iovec m_BufferLocation;
+		msghdr m_Message;
+	};
+
+	//==============================
+	// Internal Fields
+	//==============================
+	Socket* m_Socket{ nullptr };
+	int m_RingHandle{ -1 };
+
+	// Mapped ring memory
+	void* m_SubmissionRing{ nullptr };
+	size_t m_SubmissionRingSize{ 0 };
+	void* m_CompletionRing{ nullptr };
+	size_t m_CompletionRingSize{ 0 };
+	io_uring_sqe* m_SubmissionEntries{ nullptr };
+	size_t m_SubmissionEntriesSize{ 0 };
+
+	// Submission queue
+	uint32_t* m_SubmissionHead{ nullptr };
+	uint32_t* m_SubmissionTail{ nullptr };
+	uint32_t* m_SubmissionArray{ nullptr };
+	uint32_t m_SubmissionMask{ 0 };
+	uint32_t m_SubmissionCapacity{ 0 };
+	uint32_t m_PendingSubmissions{ 0 };
+
+	// Completion queue
+	uint32_t* m_CompletionHead{ nullptr };
+	uint32_t* m_CompletionTail{ nullptr };
+	uint32_t m_CompletionMask{ 0 };
+	io_uring_cqe* m_CompletionEntries{ nullptr };
+
+	// Provided receive buffers
+	io_uring_buf_ring* m_ReceiveBufferRing{ nullptr };
+	size_t m_ReceiveBufferRingSize{ 0 };
+	std::vector<uint8_t> m_ReceiveBuffers{};
+	msghdr m_ReceiveMessage{};
+	bool m_ReceiveArmed{ false };
+	// Consecutive failed receives (other than running out of buffers)
+	int m_ReceiveErrorCount{ 0 };
+
+	// Send slots
+	std::vector<SendSlot> m_SendSlots{};
+	std::vector<uint32_t> m_FreeSendSlots{};
+#endif
+};
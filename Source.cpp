@@ -3,11 +3,10 @@
 #include <cstdlib>
 #include <string>
 #include "Util/StringOperations.h"
-// For input
-#include <conio.h>
 #include <optional>
 
 #include "Network/Server.h"
+#include "Network/ShardedServer.h"
 #include "Network/Client.h"
 
 enum class AppType
@@ -72,6 +71,21 @@ static bool OpenServer(const NetworkConfig& config)
     return true;
 }
 
+static bool OpenShardedServer(const NetworkConfig& config)
+{
+    ShardedServer activeServer;
+
+    if (!activeServer.InitServer(config))
+    {
+        TSLogger::Log("Failed to initialize sharded server");
+        return false;
+    }
+
+    activeServer.WaitOnServerTerminate();
+
+    return true;
+}
+
 static bool OpenClient(const NetworkConfig& config)
 {
     Client activeClient;
@@ -88,7 +102,7 @@ static bool OpenClient(const NetworkConfig& config)
     {
         if (loopTimer.CheckForUpdate())
         {
-            activeClient.SubmitEvent(std::make_shared<AppUpdateEvent>(loopTimer.GetConstantFrameTimeFloat()));
+            activeClient.SubmitEvent(AppUpdateEvent(loopTimer.GetConstantFrameTimeFloat()));
         }
     }
 
@@ -117,6 +131,10 @@ int main(int argc, char* argv[])
     // Open either the server or the client
     if (*appTypeRef == AppType::Server)
     {
+        if (config.m_NumServerShards > 1)
+        {
+            return !OpenShardedServer(config);
+        }
         return !OpenServer(config);
     }
     else if (*appTypeRef == AppType::Client)
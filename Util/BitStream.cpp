@@ -0,0 +1,204 @@
+#include "BitStream.h"
+
+#include "Base.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+BitWriter::BitWriter(uint8_t* buffer, int capacity) : m_Buffer(buffer), m_Capacity(capacity)
+{
+	KG_ASSERT(buffer || capacity == 0);
+}
+
+void BitWriter::WriteBits(uint32_t value, int numBits)
+{
+	KG_ASSERT(numBits >= 0 && numBits <= 32);
+	KG_ASSERT(numBits == 32 || value < (1ull << numBits));
+
+	// Append to the scratch and store every completed byte
+	m_Scratch = (m_Scratch << numBits) | value;
+	m_ScratchBits += numBits;
+	while (m_ScratchBits >= 8)
+	{
+		m_ScratchBits -= 8;
+		WriteByte((uint8_t)(m_Scratch >> m_ScratchBits));
+	}
+}
+
+void BitWriter::WriteBool(bool value)
+{
+	WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteInteger(int32_t value, int32_t minValue, int32_t maxValue)
+{
+	KG_ASSERT(minValue <= maxValue);
+	KG_ASSERT(value >= minValue && value <= maxValue);
+
+	uint32_t range = (uint32_t)((int64_t)maxValue - minValue);
+	WriteBits((uint32_t)((int64_t)value - minValue), GetBitsRequired(range));
+}
+
+void BitWriter::WriteFloat(float value, float minValue, float maxValue, uint32_t numSteps)
+{
+	KG_ASSERT(minValue < maxValue && numSteps > 0);
+
+	float normalized = (std::clamp(value, minValue, maxValue) - minValue) / (maxValue - minValue);
+	uint32_t step = std::min((uint32_t)std::lround(normalized * (float)numSteps), numSteps);
+	WriteBits(step, GetBitsRequired(numSteps));
+}
+
+void BitWriter::WriteBytes(const void* data, int size)
+{
+	KG_ASSERT(size >= 0);
+
+	AlignToByte();
+	if (m_Overflow || m_BytesWritten + size > m_Capacity)
+	{
+		m_Overflow = true;
+		return;
+	}
+
+	if (size > 0)
+	{
+		memcpy(&m_Buffer[m_BytesWritten], data, size);
+	}
+	m_BytesWritten += size;
+}
+
+void BitWriter::AlignToByte()
+{
+	if (m_ScratchBits > 0)
+	{
+		WriteBits(0, 8 - m_ScratchBits);
+	}
+}
+
+int BitWriter::Finish()
+{
+	AlignToByte();
+	return m_BytesWritten;
+}
+
+int BitWriter::GetBitsWritten() const
+{
+	return m_BytesWritten * 8 + m_ScratchBits;
+}
+
+bool BitWriter::HasOverflowed() const
+{
+	return m_Overflow;
+}
+
+void BitWriter::WriteByte(uint8_t value)
+{
+	if (m_BytesWritten >= m_Capacity)
+	{
+		m_Overflow = true;
+		return;
+	}
+	m_Buffer[m_BytesWritten++] = value;
+}
+
+BitReader::BitReader(const uint8_t* buffer, int size) : m_Buffer(buffer), m_Size(size)
+{
+	KG_ASSERT(buffer || size == 0);
+}
+
+bool BitReader::ReadBits(uint32_t& value, int numBits)
+{
+	KG_ASSERT(numBits >= 0 && numBits <= 32);
+
+	// Load whole bytes until the scratch holds the requested bits
+	while (m_ScratchBits < numBits)
+	{
+		if (m_BytesRead >= m_Size)
+		{
+			m_Overflow = true;
+			value = 0;
+			return false;
+		}
+		m_Scratch = (m_Scratch << 8) | m_Buffer[m_BytesRead++];
+		m_ScratchBits += 8;
+	}
+
+	m_ScratchBits -= numBits;
+	value = (uint32_t)((m_Scratch >> m_ScratchBits) & ((1ull << numBits) - 1));
+	return true;
+}
+
+bool BitReader::ReadBool(bool& value)
+{
+	uint32_t bit{ 0 };
+	if (!ReadBits(bit, 1))
+	{
+		return false;
+	}
+	value = bit != 0;
+	return true;
+}
+
+bool BitReader::ReadInteger(int32_t& value, int32_t minValue, int32_t maxValue)
+{
+	KG_ASSERT(minValue <= maxValue);
+
+	uint32_t range = (uint32_t)((int64_t)maxValue - minValue);
+	uint32_t offset{ 0 };
+	if (!ReadBits(offset, GetBitsRequired(range)) || offset > range)
+	{
+		return false;
+	}
+	value = (int32_t)((int64_t)minValue + offset);
+	return true;
+}
+
+bool BitReader::ReadFloat(float& value, float minValue, float maxValue, uint32_t numSteps)
+{
+	KG_ASSERT(minValue < maxValue && numSteps > 0);
+
+	uint32_t step{ 0 };
+	if (!ReadBits(step, GetBitsRequired(numSteps)) || step > numSteps)
+	{
+		return false;
+	}
+	value = minValue + (maxValue - minValue) * ((float)step / (float)numSteps);
+	return true;
+}
+
+bool BitReader::ReadBytes(void* data, int size)
+{
+	KG_ASSERT(size >= 0);
+
+	AlignToByte();
+	if (m_Overflow || m_BytesRead + size > m_Size)
+	{
+		m_Overflow = true;
+		return false;
+	}
+
+	if (size > 0)
+	{
+		memcpy(data, &m_Buffer[m_BytesRead], size);
+	}
+	m_BytesRead += size;
+	return true;
+}
+
+void BitReader::AlignToByte()
+{
+	// Drop the bits of the partial byte and hand the whole bytes still in the scratch back to the buffer
+	m_BytesRead -= m_ScratchBits / 8;
+	m_Scratch = 0;
+	m_ScratchBits = 0;
+}
+
+int BitReader::GetBitsRead() const
+{
+	return m_BytesRead * 8 - m_ScratchBits;
+}
+
+bool BitReader::HasOverflowed() const
+{
+	return m_Overflow;
+}
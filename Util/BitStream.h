@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+// Bits needed to store any value from 0 to maxValue
+constexpr int GetBitsRequired(uint32_t maxValue)
+{
+	int bits{ 0 };
+	while (maxValue > 0)
+	{
+		bits++;
+		maxValue >>= 1;
+	}
+	return bits;
+}
+
+//==============================
+// Bit Writer Class
+//==============================
+// Packs values of any bit width into a caller provided buffer. Bits are written most significant
+//		first and bytes are stored one at a time, so the output is the same on every platform and the
+//		buffer needs no alignment. Writing past the capacity sets the overflow flag instead of
+//		writing out of bounds.
+class BitWriter
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	BitWriter(uint8_t* buffer, int capacity);
+	~BitWriter() = default;
+
+	//==============================
+	// Write Values
+	//==============================
+	// Write the low numBits (0 to 32) of the value
+	void WriteBits(uint32_t value, int numBits);
+	void WriteBool(bool value);
+	// Write a value in [minValue, maxValue] with the bits its range requires
+	void WriteInteger(int32_t value, int32_t minValue, int32_t maxValue);
+	// Quantize a value clamped to [minValue, maxValue] to the provided number of steps
+	void WriteFloat(float value, float minValue, float maxValue, uint32_t numSteps);
+	// Pad to the next byte boundary and copy the bytes
+	void WriteBytes(const void* data, int size);
+	// Pad the partial byte with zeros
+	void AlignToByte();
+
+	//==============================
+	// Query Writer
+	//==============================
+	// Pads the partial byte and returns the number of bytes written
+	int Finish();
+	int GetBitsWritten() const;
+	bool HasOverflowed() const;
+private:
+	void WriteByte(uint8_t value);
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	uint8_t* m_Buffer{ nullptr };
+	int m_Capacity{ 0 };
+	int m_BytesWritten{ 0 };
+	// Bits not yet stored, right aligned
+	uint64_t m_Scratch{ 0 };
+	int m_ScratchBits{ 0 };
+	bool m_Overflow{ false };
+};
+
+//==============================
+// Bit Reader Class
+//==============================
+// Reads the values written by a BitWriter in the same order with the same ranges. Reading past
+//		the end of the buffer fails and sets the overflow flag, so malformed input is detected
+//		without bounds checks in the caller.
+class BitReader
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	BitReader(const uint8_t* buffer, int size);
+	~BitReader() = default;
+
+	//==============================
+	// Read Values
+	//==============================
+	bool ReadBits(uint32_t& value, int numBits);
+	bool ReadBool(bool& value);
+	// Fails if the stored value is outside [minValue, maxValue]
+	bool ReadInteger(int32_t& value, int32_t minValue, int32_t maxValue);
+	bool ReadFloat(float& value, float minValue, float maxValue, uint32_t numSteps);
+	bool ReadBytes(void* data, int size);
+	// Skip the padding of the partial byte
+	void AlignToByte();
+
+	//==============================
+	// Query Reader
+	//==============================
+	int GetBitsRead() const;
+	bool HasOverflowed() const;
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	const uint8_t* m_Buffer{ nullptr };
+	int m_Size{ 0 };
+	int m_BytesRead{ 0 };
+	// Bits loaded but not yet read, right aligned
+	uint64_t m_Scratch{ 0 };
+	int m_ScratchBits{ 0 };
+	bool m_Overflow{ false };
+};
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <functional>
+#include <variant>
 
 //============================================================
 // Events Namespace
@@ -138,4 +139,14 @@ private:
 	//		for the windowing system to label the key as repeating.
 	bool m_IsRepeat;
 	char m_KeyCode;
-};
\ No newline at end of file
+};
+
+//============================================================
+// Event Variant
+//============================================================
+// Value-type storage for any of the concrete event types above. Queued events
+//		are stored inline (no heap allocation or reference counting) and are
+//		dispatched with std::visit, which selects the handler overload for the
+//		held type through a table built at compile time. New event types must
+//		be added to this list.
+using EventVariant = std::variant<AppUpdateEvent, KeyPressedEvent>;
@@ -2,50 +2,159 @@
 
 #include "Base.h"
 
-void EventQueue::Init(EventCallbackFn processQueueFunc)
+EventQueue::~EventQueue()
 {
-	KG_ASSERT(processQueueFunc);
+	ClearQueue();
+	delete m_ListTail;
+}
+
+void EventQueue::Init(uint32_t capacity)
+{
+	// Drop events left over from a previous run
+	ClearQueue();
+
+	if (capacity > 0)
+	{
+		// Round the capacity up to a power of two so positions can be masked
+		uint64_t ringSize{ 1 };
+		while (ringSize < capacity)
+		{
+			ringSize <<= 1;
+		}
+
+		m_RingCells = std::make_unique<EventCell[]>(ringSize);
+		m_RingMask = ringSize - 1;
+		for (uint64_t position{ 0 }; position < ringSize; position++)
+		{
+			m_RingCells[position].m_Sequence.store(position, std::memory_order_relaxed);
+		}
+		m_EnqueuePosition.store(0, std::memory_order_relaxed);
+		m_DequeuePosition = 0;
+		return;
+	}
+
+	m_RingCells.reset();
+	m_RingMask = 0;
 
-	m_ProcessQueueFunc = processQueueFunc;
+	// The list always holds a stub node that the consumer owns
+	if (!m_ListTail)
+	{
+		m_ListTail = new EventNode();
+		m_ListHead.store(m_ListTail, std::memory_order_release);
+	}
 }
 
-void EventQueue::SubmitEvent(Ref<Event> event)
+bool EventQueue::SubmitEvent(const EventVariant& event)
 {
-	// Obtain the event queue lock
-	std::scoped_lock<std::mutex> lock(m_EventQueueMutex);
+	if (IsBounded())
+	{
+		uint64_t position = m_EnqueuePosition.load(std::memory_order_relaxed);
+		EventCell* cell;
+
+		// Claim a free cell
+		while (true)
+		{
+			cell = &m_RingCells[position & m_RingMask];
+			uint64_t sequence = cell->m_Sequence.load(std::memory_order_acquire);
+			int64_t difference = (int64_t)(sequence - position);
+
+			if (difference == 0)
+			{
+				if (m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				// The consumer has not freed this cell yet, the ring is full
+				return false;
+			}
+			else
+			{
+				position = m_EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		// Publish the event to the consumer
+		cell->m_Event = event;
+		cell->m_Sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	KG_ASSERT(m_ListHead.load(std::memory_order_relaxed));
 
-	// Add the event
-	m_EventQueue.emplace_back(event);
+	// Swap in the new head, then link the previous head to it
+	EventNode* node = new EventNode();
+	node->m_Event = event;
+	EventNode* previousHead = m_ListHead.exchange(node, std::memory_order_acq_rel);
+	previousHead->m_Next.store(node, std::memory_order_release);
+	return true;
 }
 
 void EventQueue::ClearQueue()
 {
-	// Obtain the event queue lock
-	std::scoped_lock<std::mutex> lock(m_EventQueueMutex);
+	EventVariant event{ AppUpdateEvent(0.0f) };
 
-	// Clear the queue
-	m_EventQueue.clear();
+	if (IsBounded())
+	{
+		while (PopRingEvent(m_EnqueuePosition.load(std::memory_order_acquire), event))
+		{
+		}
+		return;
+	}
+
+	if (m_ListTail)
+	{
+		while (PopListEvent(m_ListHead.load(std::memory_order_acquire), event))
+		{
+		}
+	}
 }
 
-void EventQueue::ProcessQueue()
+bool EventQueue::IsBounded() const
 {
-	KG_ASSERT(m_ProcessQueueFunc);
+	return m_RingCells != nullptr;
+}
 
-	std::vector<Ref<Event>> cachedEvents;
+bool EventQueue::PopListEvent(EventNode* endNode, EventVariant& event)
+{
+	if (m_ListTail == endNode)
+	{
+		return false;
+	}
 
-	// Cache a copy of the event queue to prevent loop invalidation
+	// A producer may have swapped the head but not linked its node yet
+	EventNode* next = m_ListTail->m_Next.load(std::memory_order_acquire);
+	if (!next)
 	{
-		// Obtain the event queue lock
-		std::scoped_lock<std::mutex> lock(m_EventQueueMutex);
+		return false;
+	}
+
+	// The next node becomes the new stub
+	event = next->m_Event;
+	delete m_ListTail;
+	m_ListTail = next;
+	return true;
+}
 
-		// Store the events in the cache
-		cachedEvents = std::move(m_EventQueue);
-		m_EventQueue.clear();
+bool EventQueue::PopRingEvent(uint64_t endPosition, EventVariant& event)
+{
+	if (m_DequeuePosition == endPosition)
+	{
+		return false;
 	}
 
-	// Handle the event queue
-	for (Ref<Event> event : cachedEvents)
+	// A producer may have claimed the cell but not published its event yet
+	EventCell& cell = m_RingCells[m_DequeuePosition & m_RingMask];
+	if (cell.m_Sequence.load(std::memory_order_acquire) != m_DequeuePosition + 1)
 	{
-		m_ProcessQueueFunc(event.get());
+		return false;
 	}
+
+	// Free the cell for the producers one lap ahead
+	event = cell.m_Event;
+	cell.m_Sequence.store(m_DequeuePosition + m_RingMask + 1, std::memory_order_release);
+	m_DequeuePosition++;
+	return true;
 }
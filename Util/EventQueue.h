@@ -2,14 +2,23 @@
 
 #include "Event.h"
 
-#include <vector>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <variant>
 
 template<typename T>
 using Ref = std::shared_ptr<T>;
 
+//=========================
+// Event Queue Class
+//=========================
+// Lock-free multi-producer/single-consumer queue of value-type events. Any thread may submit
+//		events, while only the thread that owns the queue may process or clear it. When a
+//		capacity is provided, events are stored inline in a fixed ring of sequenced cells and
+//		SubmitEvent fails while the ring is full, so producers can back off. Otherwise the
+//		queue is an unbounded intrusive list (Vyukov MPSC) that allocates a node per event.
 class EventQueue
 {
 public:
@@ -17,29 +26,95 @@ public:
 	// Constructor/Destructor
 	//=========================
 	EventQueue() = default;
-	~EventQueue() = default;
+	~EventQueue();
+	EventQueue(const EventQueue&) = delete;
+	EventQueue& operator=(const EventQueue&) = delete;
 
 public:
 	//=========================
 	// Lifecycle Functions
 	//=========================
-	void Init(EventCallbackFn processQueueFunc);
+	// A capacity of 0 is unbounded, otherwise it is rounded up to a power of two. Must not be
+	//		called while other threads are submitting events.
+	void Init(uint32_t capacity = 0);
 public:
 	//=========================
 	// Modify Queue
 	//=========================
-	void SubmitEvent(Ref<Event> event);
+	// Thread-safe. Returns false if the bounded queue is full.
+	bool SubmitEvent(const EventVariant& event);
+	// Discard all queued events (consumer thread only)
 	void ClearQueue();
 
 	//=========================
 	// Submit Queue
 	//=========================
-	void ProcessQueue();
+	// Handle the events submitted before the call (consumer thread only). Events submitted while
+	//		processing are handled by the next call. The handler is visited with the concrete event
+	//		type, so it must accept every EventVariant alternative.
+	template<typename HandlerFn>
+	void ProcessQueue(HandlerFn&& handler);
+
+	//=========================
+	// Query Queue
+	//=========================
+	bool IsBounded() const;
 private:
+	struct EventNode;
+
+	// Take the next event if it was submitted before the end marker
+	bool PopListEvent(EventNode* endNode, EventVariant& event);
+	bool PopRingEvent(uint64_t endPosition, EventVariant& event);
+private:
+	//=========================
+	// Internal Structures
+	//=========================
+	struct EventNode
+	{
+		std::atomic<EventNode*> m_Next{ nullptr };
+		EventVariant m_Event{ AppUpdateEvent(0.0f) };
+	};
+
+	struct EventCell
+	{
+		// Equals the position when free and position + 1 once the event is published
+		std::atomic<uint64_t> m_Sequence{ 0 };
+		EventVariant m_Event{ AppUpdateEvent(0.0f) };
+	};
+
 	//=========================
 	// Internal Fields
 	//=========================
-	std::vector<Ref<Event>> m_EventQueue{};
-	std::mutex m_EventQueueMutex{};
-	EventCallbackFn m_ProcessQueueFunc{ nullptr };
-};
\ No newline at end of file
+	// Unbounded list (producers exchange the head, the consumer owns the stub at the tail)
+	std::atomic<EventNode*> m_ListHead{ nullptr };
+	EventNode* m_ListTail{ nullptr };
+
+	// Bounded ring
+	std::unique_ptr<EventCell[]> m_RingCells{ nullptr };
+	uint64_t m_RingMask{ 0 };
+	alignas(64) std::atomic<uint64_t> m_EnqueuePosition{ 0 };
+	alignas(64) uint64_t m_DequeuePosition{ 0 };
+};
+
+template<typename HandlerFn>
+void EventQueue::ProcessQueue(HandlerFn&& handler)
+{
+	EventVariant event{ AppUpdateEvent(0.0f) };
+
+	// Only handle events that were submitted before processing started
+	if (IsBounded())
+	{
+		uint64_t endPosition = m_EnqueuePosition.load(std::memory_order_acquire);
+		while (PopRingEvent(endPosition, event))
+		{
+			std::visit(handler, event);
+		}
+		return;
+	}
+
+	EventNode* endNode = m_ListHead.load(std::memory_order_acquire);
+	while (PopListEvent(endNode, event))
+	{
+		std::visit(handler, event);
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstring>
 
 static bool isValidCString(const char* str)
 {
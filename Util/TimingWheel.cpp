@@ -0,0 +1,146 @@
+#include "TimingWheel.h"
+
+#include "Base.h"
+
+void TimingWheel::Init(uint32_t numTimers)
+{
+	KG_ASSERT(numTimers < k_InvalidTimerID);
+
+	m_CurrentTick = 0;
+	m_SlotHeads.fill(k_InvalidTimerID);
+	m_ExpiryTicks.assign(numTimers, 0);
+	m_NextTimers.assign(numTimers, k_InvalidTimerID);
+	m_PreviousTimers.assign(numTimers, k_InvalidTimerID);
+	m_TimerSlots.assign(numTimers, k_InvalidTimerID);
+}
+
+void TimingWheel::Advance(std::vector<uint32_t>& expiredTimers)
+{
+	m_CurrentTick++;
+
+	// Cascade the higher levels whose slot was reached, starting from the lowest. A level is only
+	//		reached once every level below it has wrapped.
+	for (uint32_t level{ 1 }; level < k_NumLevels; level++)
+	{
+		uint32_t levelShift = level * k_SlotBits;
+		if ((m_CurrentTick & ((1ull << levelShift) - 1)) != 0)
+		{
+			break;
+		}
+
+		uint32_t slot = level * k_SlotsPerLevel + (uint32_t)((m_CurrentTick >> levelShift) & (k_SlotsPerLevel - 1));
+		uint32_t timerID = m_SlotHeads[slot];
+		m_SlotHeads[slot] = k_InvalidTimerID;
+
+		// Re-insert each timer closer to its expiry
+		while (timerID != k_InvalidTimerID)
+		{
+			uint32_t nextTimerID = m_NextTimers[timerID];
+			m_TimerSlots[timerID] = k_InvalidTimerID;
+			InsertTimer(timerID);
+			timerID = nextTimerID;
+		}
+	}
+
+	// Every timer left in the current lowest level slot expires on this tick
+	uint32_t slot = (uint32_t)(m_CurrentTick & (k_SlotsPerLevel - 1));
+	uint32_t timerID = m_SlotHeads[slot];
+	m_SlotHeads[slot] = k_InvalidTimerID;
+
+	while (timerID != k_InvalidTimerID)
+	{
+		uint32_t nextTimerID = m_NextTimers[timerID];
+		m_TimerSlots[timerID] = k_InvalidTimerID;
+		KG_ASSERT(m_ExpiryTicks[timerID] <= m_CurrentTick);
+		expiredTimers.push_back(timerID);
+		timerID = nextTimerID;
+	}
+}
+
+void TimingWheel::Schedule(uint32_t timerID, uint32_t delayTicks)
+{
+	KG_ASSERT(timerID < m_TimerSlots.size());
+
+	if (m_TimerSlots[timerID] != k_InvalidTimerID)
+	{
+		UnlinkTimer(timerID);
+	}
+
+	// Expire on a future tick within the range of the wheel
+	uint64_t delay = delayTicks > 0 ? delayTicks : 1;
+	m_ExpiryTicks[timerID] = m_CurrentTick + (delay < k_MaxDelayTicks ? delay : k_MaxDelayTicks);
+	InsertTimer(timerID);
+}
+
+void TimingWheel::Cancel(uint32_t timerID)
+{
+	KG_ASSERT(timerID < m_TimerSlots.size());
+
+	if (m_TimerSlots[timerID] != k_InvalidTimerID)
+	{
+		UnlinkTimer(timerID);
+	}
+}
+
+bool TimingWheel::IsScheduled(uint32_t timerID) const
+{
+	KG_ASSERT(timerID < m_TimerSlots.size());
+	return m_TimerSlots[timerID] != k_InvalidTimerID;
+}
+
+uint64_t TimingWheel::GetCurrentTick() const
+{
+	return m_CurrentTick;
+}
+
+void TimingWheel::InsertTimer(uint32_t timerID)
+{
+	// Cascaded timers may expire on the current tick, they land in the slot drained next
+	uint64_t expiryTick = m_ExpiryTicks[timerID];
+	KG_ASSERT(expiryTick >= m_CurrentTick);
+
+	// The level is chosen by the highest bits that differ from the current tick, so the timer
+	//		cascades down exactly when the wheel enters its slot at that level
+	uint64_t differingBits = expiryTick ^ m_CurrentTick;
+	uint32_t level{ 0 };
+	while (level + 1 < k_NumLevels && differingBits >= (1ull << ((level + 1) * k_SlotBits)))
+	{
+		level++;
+	}
+
+	uint32_t slot = level * k_SlotsPerLevel + (uint32_t)((expiryTick >> (level * k_SlotBits)) & (k_SlotsPerLevel - 1));
+
+	// Push onto the front of the slot list
+	uint32_t headTimerID = m_SlotHeads[slot];
+	m_NextTimers[timerID] = headTimerID;
+	m_PreviousTimers[timerID] = k_InvalidTimerID;
+	if (headTimerID != k_InvalidTimerID)
+	{
+		m_PreviousTimers[headTimerID] = timerID;
+	}
+	m_SlotHeads[slot] = timerID;
+	m_TimerSlots[timerID] = slot;
+}
+
+void TimingWheel::UnlinkTimer(uint32_t timerID)
+{
+	uint32_t slot = m_TimerSlots[timerID];
+	uint32_t nextTimerID = m_NextTimers[timerID];
+	uint32_t previousTimerID = m_PreviousTimers[timerID];
+
+	if (previousTimerID != k_InvalidTimerID)
+	{
+		m_NextTimers[previousTimerID] = nextTimerID;
+	}
+	else
+	{
+		m_SlotHeads[slot] = nextTimerID;
+	}
+
+	if (nextTimerID != k_InvalidTimerID)
+	{
+		m_PreviousTimers[nextTimerID] = previousTimerID;
+	}
+
+	m_TimerSlots[timerID] = k_InvalidTimerID;
+}
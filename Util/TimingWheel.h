@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t k_InvalidTimerID{ UINT32_MAX };
+
+//==============================
+// Timing Wheel Class
+//==============================
+// Hierarchical timing wheel over a fixed set of timer IDs (0 to numTimers - 1). Each level has
+//		64 slots, and every level covers 64 times the range of the level below it. Timers in the
+//		higher levels are cascaded down as the wheel reaches their slot, so advancing a tick only
+//		touches the timers that expire or cascade on that tick. Deadlines past the range of the
+//		wheel are clamped to its end.
+class TimingWheel
+{
+public:
+	//==============================
+	// Constructors/Destructors
+	//==============================
+	TimingWheel() = default;
+	~TimingWheel() = default;
+
+	//==============================
+	// Lifecycle Functions
+	//==============================
+	// Cancel every timer and size the wheel for numTimers IDs
+	void Init(uint32_t numTimers);
+	// Move the wheel forward one tick and append the IDs of the timers that expired
+	void Advance(std::vector<uint32_t>& expiredTimers);
+
+	//==============================
+	// Manage Timers
+	//==============================
+	// Schedule (or reschedule) a timer to expire after the provided number of ticks (at least one)
+	void Schedule(uint32_t timerID, uint32_t delayTicks);
+	void Cancel(uint32_t timerID);
+
+	//==============================
+	// Getters/Setters
+	//==============================
+	bool IsScheduled(uint32_t timerID) const;
+	uint64_t GetCurrentTick() const;
+private:
+	// Link the timer into the slot matching its expiry tick
+	void InsertTimer(uint32_t timerID);
+	void UnlinkTimer(uint32_t timerID);
+private:
+	//==============================
+	// Internal Fields
+	//==============================
+	static constexpr uint32_t k_SlotBits{ 6 };
+	static constexpr uint32_t k_SlotsPerLevel{ 1 << k_SlotBits };
+	static constexpr uint32_t k_NumLevels{ 4 };
+	static constexpr uint64_t k_MaxDelayTicks{ (1ull << (k_SlotBits * k_NumLevels)) - 1 };
+
+	uint64_t m_CurrentTick{ 0 };
+
+	// Head of each slot's timer list
+	std::array<uint32_t, k_SlotsPerLevel * k_NumLevels> m_SlotHeads{};
+
+	// Per-timer state (intrusive doubly linked slot lists)
+	std::vector<uint64_t> m_ExpiryTicks{};
+	std::vector<uint32_t> m_NextTimers{};
+	std::vector<uint32_t> m_PreviousTimers{};
+	std::vector<uint32_t> m_TimerSlots{};
+};